@@ -26,9 +26,14 @@ build/rtl/%.json: rtl/%.sv
 	@mkdir -p `dirname "$@"`
 	yosys \
 		-q \
+		-D 'ATLAS="${ATLAS}"' \
 		-D 'BAUDS=${BAUDS}' \
 		-D 'ECP5' \
 		-D 'FCLK=${FCLK}' \
+		-D 'PIXEL="${strip ${PIXEL}}"' \
+		-D 'SCALE=${SCALE}' \
+		${if ${SWATCH},-D 'SWATCH="${SWATCH}"'} \
+		-D 'XFIX=${strip ${XFIX}}' \
 		-p 'read -incdir rtl' \
 		-p 'synth_ecp5 -abc2' \
 		-p 'write_json "$@"' \
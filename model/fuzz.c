@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// The firmware headers bring their own.
+#undef NULL
+
+#include "u.h"
+#include "graphics.h"
+#include "ouija.h"
+
+//
+// Generates random triangles for `test/rasterizer.sv`, along with what the
+// model expects from them: cycles and pixel checksum for each triangle, and
+// the final framebuffer.
+//
+// usage: fuzz DIR [TRIANGLES [SEED]]
+//
+
+// Same as the testbench.
+#define MAX_TRIANGLES   4096U
+
+#define REG_WORDS       (sizeof(Ouija) / sizeof(unsigned))
+
+static OuijaModel model;
+static unsigned state;
+
+static unsigned
+random_word(void)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return state;
+}
+
+// Uniform in [lo, hi), steps of 1/256.
+static fix
+random_fix(const fix lo, const fix hi)
+{
+	return lo + (fix)(random_word() % ((uint)(hi - lo) >> 8) << 8);
+}
+
+static void
+random_triangle(Ouija *const regs)
+{
+	if (random_word() % 4 == 0) {
+		// Anything goes, to reach the corners of the fixed-point formats.
+		unsigned *const words = (unsigned *)regs;
+
+		for (unsigned pos = 0; pos < REG_WORDS; pos++)
+			words[pos] = random_word();
+
+		// Only inputs, the rest are status or strobes.
+		regs->v_blank = 0;
+		regs->fire = 0;
+		regs->busy = 0;
+		regs->drawn = 0;
+
+		return;
+	}
+
+	// Same projection as `render_model`, seen from around the origin.
+	regs->matrix.i = (Vec4) { FIX(FRAME_H), 0, 0, random_fix(FIX(-1), FIX(1)) };
+	regs->matrix.j = (Vec4) { 0, FIX(FRAME_H), 0, random_fix(FIX(-1), FIX(1)) };
+	regs->matrix.k = (Vec4) { 0, 0, 0, 0 };
+	regs->matrix.l = (Vec4) { 0, 0, FIX(1), FIX(1) };
+
+	const Vec3 center = {
+		random_fix(FIX(-2), FIX(2)),
+		random_fix(FIX(-2), FIX(2)),
+		random_fix(FIX(0), FIX(4)),
+	};
+
+	Vertex *const vertices[] = {
+		&regs->triangle.a,
+		&regs->triangle.b,
+		&regs->triangle.c,
+	};
+
+	for (int pos = 0; pos < 3; pos++) {
+		vertices[pos]->xyz = (Vec3) {
+			center.x + random_fix(FIX(-0.5), FIX(0.5)),
+			center.y + random_fix(FIX(-0.5), FIX(0.5)),
+			center.z + random_fix(FIX(-0.25), FIX(0.25)),
+		};
+
+		vertices[pos]->uv = (Vec2) { random_word(), random_word() };
+	}
+
+	regs->texel_format = random_word() % 4;
+	regs->palette_base = random_word() % 256;
+	regs->shading = random_word() % 3;
+	regs->color = random_word();
+}
+
+static FILE *
+create(const char *const dir, const char *const name)
+{
+	static char path[4096];
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+	FILE *const file = fopen(path, "w");
+
+	if (!file) {
+		perror(path);
+		exit(1);
+	}
+
+	return file;
+}
+
+// Memory contents for `$readmemh`, as wide as RGB 6:6:6 words.
+static void
+dump(FILE *const file, const unsigned words[], const unsigned len)
+{
+	for (unsigned pos = 0; pos < len; pos++)
+		fprintf(file, "%05x\n", words[pos]);
+
+	fclose(file);
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "usage: %s DIR [TRIANGLES [SEED]]\n", argv[0]);
+		return 1;
+	}
+
+	const char *const dir = argv[1];
+	const unsigned len = argc > 2 ? strtoul(argv[2], NULL, 0) : 256;
+	state = argc > 3 ? strtoul(argv[3], NULL, 0) : 1;
+
+	if (len > MAX_TRIANGLES || !state) {
+		fprintf(stderr, "%s: at most %u triangles, seed not 0\n", argv[0], MAX_TRIANGLES);
+		return 1;
+	}
+
+	for (unsigned pos = 0; pos < NELEMS(model.atlas); pos++)
+		model.atlas[pos] = random_word() & 0x3FFFF;
+
+	for (unsigned pos = 0; pos < NELEMS(model.swatches); pos++)
+		model.swatches[pos] = random_word() & 0x3FFFF;
+
+	dump(create(dir, "atlas.hex"), model.atlas, NELEMS(model.atlas));
+	dump(create(dir, "swatches.hex"), model.swatches, NELEMS(model.swatches));
+
+	FILE *const triangles = create(dir, "triangles.hex");
+	FILE *const expected = create(dir, "expected.hex");
+
+	for (unsigned tri = 0; tri < len; tri++) {
+		random_triangle(&model.regs);
+
+		const unsigned cycles = ouija_fire(&model);
+
+		const unsigned *const words = (const unsigned *)&model.regs;
+
+		for (unsigned pos = 0; pos < REG_WORDS; pos++)
+			fprintf(triangles, "%08x\n", words[pos]);
+
+		fprintf(expected, "%08x\n%08x\n", cycles, model.pixel_hash);
+	}
+
+	fclose(triangles);
+	fclose(expected);
+
+	dump(create(dir, "frame.hex"), model.frame, NELEMS(model.frame));
+
+	printf(
+		"%llu triangles, %llu culled, %llu fragments, %llu cycles\n",
+		model.triangles,
+		model.culled,
+		model.fragments,
+		model.cycles);
+
+	return 0;
+}
@@ -0,0 +1,21 @@
+fuzz: build/model/fuzz build/test/rasterizer.vvp
+	@mkdir -p build/fuzz
+	build/model/fuzz build/fuzz ${FUZZ} ${SEED}
+	vvp build/test/rasterizer.vvp +triangles=${FUZZ}
+
+build/model/fuzz: \
+	model/fuzz.c \
+	model/ouija.c \
+	model/ouija.h \
+	src/graphics.h \
+	src/u.h \
+
+build/model/%:
+	@mkdir -p `dirname "$@"`
+	cc \
+		-DPIXEL_${strip ${PIXEL}} \
+		-DSCALE=${SCALE} \
+		-I src \
+		-o "$@" \
+		${CFLAGS} \
+		${filter %.c,$^}
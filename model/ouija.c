@@ -0,0 +1,357 @@
+#include "u.h"
+#include "graphics.h"
+#include "ouija.h"
+
+//
+// Every step below mirrors a state of `Video_Rasterizer`, with the same
+// widths, truncations and signedness. Values are kept as `uint` wherever
+// the hardware lets them wrap around, and only reinterpreted as signed to
+// compare them.
+//
+
+//
+// Cycle counts of the fixed parts of `Video_Rasterizer`, from the edge that
+// takes `fire`, counted by hand from the states below. The testbench
+// compares them with the RTL for every triangle, as part of the cycles the
+// model returns.
+//
+// T_CULL: the 13 S_XFORM_* states run back to back. The reciprocal of w
+// starts after S_XFORM_B_X and takes 32 cycles, which S_NORMALIZE_X waits
+// for, at 39. S_NORMALIZE_Y through S_WEIGHT_0 take one cycle each, and
+// S_WEIGHT_1 culls at 46.
+//
+// T_SETUP: S_WEIGHT_2 starts the reciprocal of the area at 47, and
+// S_SETUP_RASTERIZER_3 waits for its 32 cycles. S_RASTERIZING tests one
+// fragment per cycle from then on, so fragment `n` is tested at
+// T_SETUP + n.
+//
+// T_DRAIN: an untextured fragment inside the triangle is painted on the
+// next cycle, then strobed to the framebuffer. It is acknowledged on the
+// cycle after that, and leaves `pixels_in_flight` on the fourth.
+//
+// T_TEXTURED: textured fragments take three more cycles between paint and
+// pixel strobe: texel strobe, texel ack and shade.
+//
+
+#define T_CULL       46U
+#define T_SETUP      80U
+#define T_DRAIN      4U
+#define T_TEXTURED   7U
+
+#define F_NUM_WORDS  (FRAME_W * FRAME_H)
+#define F_ADDR_MASK  ((1U << BITS(F_NUM_WORDS - 1)) - 1)
+#define A_ADDR_MASK  (ATLAS_W*ATLAS_H - 1)
+
+#define SIGNED(u)    ((int)(uint)(u))
+
+// One row of the matrix times (x, y, z, 1), keeping bits 47:16.
+static uint
+matrix_row(const Vec4 row, const Vec3 pos)
+{
+	const uvlong sum =
+		  (uvlong)((vlong)row.x * pos.x)
+		+ (uvlong)((vlong)row.y * pos.y)
+		+ (uvlong)((vlong)row.z * pos.z)
+		+ ((uvlong)(vlong)row.w << 16);
+
+	return sum >> 16;
+}
+
+// Restoring division of 1.0 by `divisor`, one quotient bit per cycle.
+// Bit 0 never gets computed.
+static uvlong
+reciprocal(uvlong divisor)
+{
+	uvlong dividend = 1ULL << 32;
+	uvlong quotient = 0;
+
+	for (uvlong mask = 1ULL << 32; mask > 1; mask >>= 1, divisor >>= 1)
+		if (dividend >= divisor) {
+			dividend -= divisor;
+			quotient |= mask;
+		}
+
+	return quotient;
+}
+
+// 16.16 product, keeping bits 47:16.
+static uint
+ndc(const uint homo, const uint one_over_w)
+{
+	return (uvlong)((vlong)SIGNED(homo) * SIGNED(one_over_w)) >> 16;
+}
+
+// Edge function at the origin, biased by the top-left rule.
+static uint
+edge(const uint e_x, const uint e_y, const uint o_x, const uint o_y)
+{
+	const uvlong cross =
+		  (uvlong)((vlong)SIGNED(e_x) * SIGNED(o_y))
+		- (uvlong)((vlong)SIGNED(e_y) * SIGNED(o_x));
+
+	const uint bias = (!e_y && SIGNED(e_x) >= 0) || SIGNED(e_y) >= 0;
+
+	return (uint)(cross >> 16) - bias;
+}
+
+// Barycentric weight, as a 0.16 fraction.
+static ushort
+weight(const uint k, const uint area_reciprocal)
+{
+	return (uvlong)((vlong)SIGNED(k) * SIGNED(area_reciprocal)) >> 32;
+}
+
+static uint
+rgb444_to_666(const uint texel)
+{
+	const uint r = texel >> 8 & 0xF;
+	const uint g = texel >> 4 & 0xF;
+	const uint b = texel & 0xF;
+
+	return
+		  (r << 2 | r >> 2) << 12
+		| (g << 2 | g >> 2) << 6
+		| (b << 2 | b >> 2);
+}
+
+static uint
+rgb666_pack(const uint word)
+{
+	return (word >> 16 & 077) << 12 | (word >> 8 & 077) << 6 | (word & 077);
+}
+
+// Texel from the atlas, already looked up in the palette if indexed.
+static uint
+fetch_texel(const OuijaModel *const model, const uint u, const uint v)
+{
+	const uint format = model->regs.texel_format & 03;
+	const uint palette = model->regs.palette_base;
+
+	// Indexed rows are twice as long, see `Video_Rasterizer`.
+	const uint index = format & 02 ? 2*ATLAS_W*v + u : ATLAS_W*v + u;
+	const uint slot = index & 03;
+
+	const uint addr =
+		format == TEXEL_INDEXED4 ?   index >> 2   :
+		format == TEXEL_INDEXED8 ?   index >> 1   :
+		/* else ? */                 index;
+
+	const uint texel = model->atlas[addr & A_ADDR_MASK];
+
+	switch (format) {
+	case TEXEL_RGB444:
+		return rgb444_to_666(texel);
+
+	case TEXEL_INDEXED8:
+		return model->swatches[(palette + (texel >> 8*(slot & 01))) & 0xFF];
+
+	case TEXEL_INDEXED4:
+		return model->swatches[(palette + (texel >> 4*slot & 0xF)) & 0xFF];
+
+	default:
+		return texel;
+	}
+}
+
+// Three values weighted by 0.16 fractions, the last one by what the other
+// two leave. Differences to `c` are signed, and the sum wraps around.
+static uint
+interpolate(
+	const ushort alpha,
+	const ushort beta,
+	const uint a,
+	const uint b,
+	const uint c)
+{
+	return (c << 16) + (uint)alpha*(a - c) + (uint)beta*(b - c);
+}
+
+static uint
+to_pixel(const uint color)
+{
+	const uint r = color >> 12 & 077;
+	const uint g = color >> 6 & 077;
+	const uint b = color & 077;
+
+#if defined(PIXEL_INDEXED)
+	return (r >> 3) << 5 | (g >> 3) << 2 | b >> 4;
+#elif defined(PIXEL_RGB444)
+	return (r >> 2) << 8 | (g >> 2) << 4 | b >> 2;
+#else
+	(void)r;
+	(void)g;
+	(void)b;
+	return color;
+#endif
+}
+
+static void
+paint(
+	OuijaModel *const model,
+	const short x,
+	const short y,
+	const ushort alpha,
+	const ushort beta)
+{
+	const Ouija *const regs = &model->regs;
+	const Vertex a = regs->triangle.a;
+	const Vertex b = regs->triangle.b;
+	const Vertex c = regs->triangle.c;
+
+	uint color;
+
+// Coordinates keep 8 integer and 8 fractional bits. Gouraud colors are taken
+// from `u`, one 6-bit channel per byte.
+#define UV(f)         ((uint)(f) >> 8 & 0xFFFF)
+#define TEX(f)        (interpolate(alpha, beta, UV(a.f), UV(b.f), UV(c.f)) >> 24)
+#define RGB(v, s)     ((uint)v.uv.x >> (s) & 077)
+#define GOURAUD(s)    (interpolate(alpha, beta, RGB(a, s), RGB(b, s), RGB(c, s)) >> 16 & 077)
+
+	switch (regs->shading & 03) {
+	case SHADE_TEXTURED:
+		color = fetch_texel(model, TEX(uv.x), TEX(uv.y));
+		break;
+
+	case SHADE_FLAT:
+		color = rgb666_pack(regs->color);
+		break;
+
+	default:
+		color = GOURAUD(16) << 12 | GOURAUD(8) << 6 | GOURAUD(0);
+		break;
+	}
+
+#undef GOURAUD
+#undef RGB
+#undef TEX
+#undef UV
+
+	// Out of range addresses are dropped by the framebuffer BRAM.
+	const uint addr = (FRAME_W * (uint)(ushort)y + (ushort)x) & F_ADDR_MASK;
+	const uint pixel = to_pixel(color);
+
+	if (addr < F_NUM_WORDS)
+		model->frame[addr] = pixel;
+
+	model->pixel_hash = OUIJA_HASH(model->pixel_hash, addr, pixel);
+	model->fragments++;
+}
+
+unsigned
+ouija_fire(OuijaModel *const model)
+{
+	const Ouija *const regs = &model->regs;
+	const Mat4 *const m = &regs->matrix;
+
+	const Vec3 xyz[3] = {
+		regs->triangle.a.xyz,
+		regs->triangle.b.xyz,
+		regs->triangle.c.xyz,
+	};
+
+	// Normalized device coordinates, in pixels.
+	uint x[3], y[3];
+
+	model->triangles++;
+	model->pixel_hash = 0;
+
+	for (int pos = 0; pos < 3; pos++) {
+		const uint one_over_w = reciprocal((uvlong)matrix_row(m->l, xyz[pos]) << 32);
+
+		x[pos] = ndc(matrix_row(m->i, xyz[pos]), one_over_w);
+		y[pos] = ndc(matrix_row(m->j, xyz[pos]), one_over_w);
+	}
+
+	// Twice the signed area, split in its two products.
+	const vlong area_1 = (vlong)SIGNED(x[1] - x[0]) * SIGNED(y[2] - y[0]);
+	const vlong area_2 = (vlong)SIGNED(y[1] - y[0]) * SIGNED(x[2] - x[0]);
+
+	if (area_1 <= area_2) {
+		model->culled++;
+		model->cycles += T_CULL;
+		return T_CULL;
+	}
+
+	const uint area_reciprocal = reciprocal((uvlong)area_1 - (uvlong)area_2);
+
+	// Screen-space rectangle, clamped to the frame and centered on it.
+	short min_x = MIN(MIN(SIGNED(x[0]), SIGNED(x[1])), SIGNED(x[2])) >> 16;
+	short max_x = MAX(MAX(SIGNED(x[0]), SIGNED(x[1])), SIGNED(x[2])) >> 16;
+	short min_y = MIN(MIN(SIGNED(y[0]), SIGNED(y[1])), SIGNED(y[2])) >> 16;
+	short max_y = MAX(MAX(SIGNED(y[0]), SIGNED(y[1])), SIGNED(y[2])) >> 16;
+
+	min_x = MAX(min_x, -FRAME_W/2);
+	max_x = MIN(max_x,  FRAME_W/2 - 1);
+	min_y = MAX(min_y, -FRAME_H/2);
+	max_y = MIN(max_y,  FRAME_H/2 - 1);
+
+	// Center of the top left pixel, before centering.
+	const uint o_x = (uint)(ushort)min_x << 16 | 0x8000;
+	const uint o_y = (uint)(ushort)min_y << 16 | 0x8000;
+
+	uint k_row[3] = {
+		edge(x[2] - x[1], y[2] - y[1], o_x - x[1], o_y - y[1]),
+		edge(x[0] - x[2], y[0] - y[2], o_x - x[2], o_y - y[2]),
+		edge(x[1] - x[0], y[1] - y[0], o_x - x[0], o_y - y[0]),
+	};
+
+	const uint k_dx[3] = { y[1] - y[2], y[2] - y[0], y[0] - y[1] };
+	const uint k_dy[3] = { x[2] - x[1], x[0] - x[2], x[1] - x[0] };
+
+	uint k[3] = { k_row[0], k_row[1], k_row[2] };
+
+	min_x += FRAME_W/2;
+	max_x += FRAME_W/2;
+	min_y += FRAME_H/2;
+	max_y += FRAME_H/2;
+
+	short px = min_x;
+	short py = min_y;
+
+	// Cycles spent rasterizing, and when the last fragment was found.
+	unsigned steps = 0;
+	unsigned last = 0;
+
+	for (;;) {
+		steps++;
+
+		if (SIGNED(k[0]) >= 0 && SIGNED(k[1]) >= 0 && SIGNED(k[2]) >= 0) {
+			paint(
+				model,
+				px,
+				py,
+				weight(k[0], area_reciprocal),
+				weight(k[1], area_reciprocal));
+
+			last = steps;
+		}
+
+		if (px >= max_x && py >= max_y)
+			break;
+
+		if (px >= max_x) {
+			px = min_x;
+			py++;
+
+			for (int pos = 0; pos < 3; pos++)
+				k[pos] = k_row[pos] += k_dy[pos];
+
+		} else {
+			px++;
+
+			for (int pos = 0; pos < 3; pos++)
+				k[pos] += k_dx[pos];
+
+		}
+	}
+
+	const unsigned drain =
+		(regs->shading & 03) == SHADE_TEXTURED ? T_TEXTURED : T_DRAIN;
+
+	const unsigned cycles =
+		last ?         MAX(T_SETUP + steps, T_SETUP + last + drain)   :
+		/* else ? */   T_SETUP + steps;
+
+	model->cycles += cycles;
+	return cycles;
+}
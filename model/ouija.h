@@ -0,0 +1,38 @@
+// Host-side model of the rasterizer behind `OUIJA`, written after
+// `Video_Rasterizer` for the same SCALE and PIXEL settings. `make fuzz` is
+// what tells whether both agree, pixels and cycles alike.
+//
+// Registers are set in `regs` like the firmware sets them through `OUIJA`,
+// and `ouija_fire` stands for writing `fire`. Memories hold the same words
+// as their BRAMs, so atlases and palettes encoded for `$readmemh` can be
+// loaded as they are.
+
+#ifndef ATLAS_W
+#define ATLAS_W   128
+#define ATLAS_H   128
+#endif
+
+typedef struct {
+	Ouija regs;
+
+	unsigned frame[FRAME_W * FRAME_H];
+	unsigned atlas[ATLAS_W * ATLAS_H];
+	unsigned swatches[256];
+
+	// Totals since the model was cleared.
+	uvlong triangles;
+	uvlong culled;
+	uvlong fragments;
+	uvlong cycles;
+
+	// Checksum of the pixel writes of the last triangle, in order.
+	unsigned pixel_hash;
+} OuijaModel;
+
+// Draws the triangle in `regs` and returns the cycles the rasterizer should
+// stay busy, from the `fire` write until it reads back as idle. It assumes the
+// CPU leaves the framebuffer alone in the meantime.
+unsigned ouija_fire(OuijaModel *const model);
+
+// Checksum step for a pixel write, shared with the testbench.
+#define OUIJA_HASH(hash, addr, pixel)   ((hash) * 33U ^ ((addr) << 18 | (pixel)))
@@ -37,6 +37,32 @@ module BRAM #(
 	initial if (FILE !== 'x)
 		$readmemh(FILE, data);
 
+	//
+	// Strobes on the CPU data bus must be answered on the next cycle, which
+	// the store queue in `RISCV` relies on to keep its place. Late answers
+	// would make it skip or repeat stores.
+	//
+
+`ifdef DELAY_1_1
+	$fatal(1, "DELAY_1_1 answers late, which the bus does not allow");
+`endif
+
+`ifdef DELAY_1_5
+	$fatal(1, "DELAY_1_5 answers late, which the bus does not allow");
+`endif
+
+`ifdef DELAY_2_2
+	$fatal(1, "DELAY_2_2 answers late, which the bus does not allow");
+`endif
+
+`ifdef DELAY_2_5
+	$fatal(1, "DELAY_2_5 answers late, which the bus does not allow");
+`endif
+
+`ifdef DELAY_2_7
+	$fatal(1, "DELAY_2_7 answers late, which the bus does not allow");
+`endif
+
 `ifdef PING_PONG_1
 	bit ping_pong_1 = 0;
 `endif
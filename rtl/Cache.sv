@@ -0,0 +1,134 @@
+module Cache #(
+	parameter
+		ADDR_BITS,
+		LINES = 64,
+
+	localparam
+		// One SDRAM burst.
+		LINE_WORDS = 4,
+		WORD_BITS  = $clog2(LINE_WORDS),
+		INDEX_BITS = $clog2(LINES),
+		TAG_BITS   = ADDR_BITS - INDEX_BITS - WORD_BITS,
+		SLOT_BITS  = INDEX_BITS + WORD_BITS
+) (
+	input wire                 clock,
+
+	// CPU port.
+	input wire[ADDR_BITS-1:0]  addr,
+	input wire[31:0]           in,
+	output bit[31:0]           out,
+	input wire[3:0]            select,
+	input wire                 write,
+	input wire                 strobe,
+	output bit                 ack = 0,
+	output bit                 retry = 0,
+
+	// Forget every line, for when memory changed behind the cache's back.
+	input wire                 invalidate,
+
+	// Memory port.
+	output bit[ADDR_BITS-1:0]  mem_addr,
+	input wire[31:0]           mem_in,
+	output bit[31:0]           mem_out,
+	output bit[3:0]            mem_select,
+	output bit                 mem_read = 0,
+	output bit                 mem_write = 0,
+	input wire                 mem_valid,
+	input wire                 mem_done
+);
+
+	//
+	// Direct-mapped, write-through, and without allocation on writes.
+	//
+	// Read hits are acknowledged after 1 cycle. Read misses are retried
+	// until the line has been fetched. Writes are retried until the memory
+	// has finished with the previous request, and update the line if it is
+	// already cached.
+	//
+	// Invalidating also drops the line being fetched, if any, as it may
+	// have been read before the change.
+	//
+
+	bit[31:0] data[LINES * LINE_WORDS];
+	bit[TAG_BITS-1:0] tags[LINES];
+	bit[LINES-1:0] valid = 0;
+	bit dropped = 0;
+
+	wire[INDEX_BITS-1:0] index = addr[WORD_BITS +: INDEX_BITS];
+	wire[TAG_BITS-1:0] tag = addr[ADDR_BITS-1 -: TAG_BITS];
+
+	wire hit = valid[index] && tags[index] == tag;
+	wire busy = mem_read || mem_write;
+
+	wire
+		take_read  = strobe && !write && hit,
+		take_write = strobe &&  write && !busy,
+		miss       = strobe && !write && !hit && !busy;
+
+	// Line being fetched, and where its next word goes.
+	wire[INDEX_BITS-1:0] fill_index = mem_addr[WORD_BITS +: INDEX_BITS];
+	bit[WORD_BITS-1:0] fill_word;
+
+	wire fill = mem_read && mem_valid;
+
+	// Fills and write hits share the write port.
+	wire[SLOT_BITS-1:0] store_slot =
+		fill ?         { fill_index, fill_word }   :
+		/* else ? */   addr[SLOT_BITS-1:0];
+
+	wire[31:0] store_data = fill ? mem_in : in;
+	wire[3:0] store_select = fill ? 'b1111 : select;
+	wire store = fill || take_write && hit;
+
+	always @(posedge clock) begin
+		out <= data[addr[SLOT_BITS-1:0]];
+		ack <= take_read || take_write;
+		retry <= strobe && !take_read && !take_write;
+
+		if (take_write) begin
+			mem_addr <= addr;
+			mem_out <= in;
+			mem_select <= select;
+			mem_write <= 1;
+
+		end else if (miss) begin
+			mem_addr <= addr & ~(LINE_WORDS-1);
+			mem_read <= 1;
+			fill_word <= 0;
+
+			// Keep it from hitting while only partially fetched.
+			tags[index] <= tag;
+			valid[index] <= 0;
+		end
+
+		if (fill)
+			fill_word <= fill_word+1;
+
+		if (mem_done) begin
+			if (mem_read && !dropped)
+				valid[fill_index] <= 1;
+
+			dropped <= 0;
+			mem_read <= 0;
+			mem_write <= 0;
+		end
+
+		if (invalidate) begin
+			valid <= 0;
+			dropped <= mem_read && !mem_done;
+		end
+
+	end
+
+	for (genvar idx = 0; idx < 4; idx++) begin
+
+`define SLICE   8*idx +: 8
+
+		always @(posedge clock) if (store && store_select[idx])
+			data[store_slot][`SLICE] <= store_data[`SLICE];
+
+`undef SLICE
+
+	end
+
+endmodule
@@ -0,0 +1,107 @@
+module Profiler #(
+	parameter
+		DEPTH = 512,
+
+	localparam
+		SLOT_BITS = $clog2(DEPTH)
+) (
+	input wire         clock,
+	input wire         retire,
+	input wire[31:0]   retire_pc,
+
+	input wire[1:0]    addr,
+	input wire[31:0]   in,
+	output bit[31:0]   out,
+	input wire         select,
+	input wire         write,
+	input wire         strobe,
+	output bit         ack = 0,
+	output bit         retry = 0
+);
+
+	//
+	// Every `period` cycles, the next instruction to retire gets its PC
+	// pushed into the sample queue. Instructions stalled by slow memory
+	// accesses retire late, so they are sampled as often as the time they
+	// spend blocking the pipeline.
+	//
+	// A period of 0 stops sampling. Samples arriving while the queue is full
+	// are dropped and counted.
+	//
+
+	bit[31:0]
+		period  = 0,
+		counter = 0,
+		dropped = 0;
+
+	bit[31:0] samples[DEPTH];
+
+	// The extra bit tells a full queue apart from an empty one.
+	bit[SLOT_BITS:0]
+		head = 0,
+		tail = 0;
+
+	bit armed = 0;
+
+	wire[SLOT_BITS:0] count = tail - head;
+
+	wire
+		full  = count == DEPTH,
+		empty = count == 0;
+
+`define reading(a)   (addr == a && strobe && select && !write)
+`define writing(a)   (addr == a && strobe && select &&  write)
+
+	always @(posedge clock) begin
+
+		// MMIO responds in 1 cycle
+		ack <= strobe;
+
+		out <=
+			(addr == 0 ?    period                     : 0) |
+			(addr == 1 ?    count                      : 0) |
+			(addr == 2 ?    samples[SLOT_BITS'(head)]  : 0) |
+			(addr == 3 ?    dropped                    : 0);
+
+	end
+
+	always @(posedge clock) begin
+		if (`writing(0)) begin
+			period <= in;
+			counter <= in;
+			armed <= 0;
+
+		end else if (period) begin
+			if (!counter) begin
+				counter <= period-1;
+				armed <= 1;
+
+			end else
+				counter <= counter-1;
+
+			if (armed && retire) begin
+				armed <= !counter;
+
+				if (!full) begin
+					samples[SLOT_BITS'(tail)] <= retire_pc;
+					tail <= tail+1;
+
+				end else
+					dropped <= dropped+1;
+
+			end
+
+		end
+
+		if (`reading(2) && !empty)
+			head <= head+1;
+
+		if (`writing(3))
+			dropped <= in;
+
+	end
+
+`undef writing
+`undef reading
+
+endmodule
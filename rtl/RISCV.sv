@@ -1,7 +1,12 @@
 module RISCV #(
 	parameter
-		ADDR_BITS = 32,
-		RESET_PC  = 0
+		ADDR_BITS   = 32,
+		RESET_PC    = 0,
+		STORE_SLOTS = 4,
+		XFIX        = 1,
+
+	localparam
+		SLOT_BITS   = $clog2(STORE_SLOTS)
 ) (
 	input wire                 clock,
 
@@ -18,11 +23,16 @@ module RISCV #(
 	output wire                write,
 	output wire                data_strobe,
 	input wire                 data_ack,
-	input wire                 data_retry
+	input wire                 data_retry,
+
+	output wire                retire,
+	output wire[31:0]          retire_pc,
+
+	// A fence.i retired, instruction caches must forget what they hold.
+	output wire                flush
 );
 
 	// TODO: LOAD sign.
-	// TODO: memory I/O retry support.
 	// TODO: clean up.
 
 	// Instruction opcodes.
@@ -37,7 +47,9 @@ module RISCV #(
 		ALUR   = 'b01100_11,
 		ALUI   = 'b00100_11,
 		ALU    = 'b0?100_11,
-		SYSTEM = 'b11100_11;
+		FENCE  = 'b00011_11,
+		SYSTEM = 'b11100_11,
+		CUSTOM = 'b00010_11;
 
 	// Helpers to extract instruction slices
 `define i(i)          32'($signed({ i[31], i[30:20] }))
@@ -67,12 +79,18 @@ module RISCV #(
 `define store(i)    (`op(i) == STORE)
 `define alui(i)     (`op(i) == ALUI)
 `define alur(i)     (`op(i) == ALUR)
+`define fence(i)    (`op(i) == FENCE)
+`define fencei(i)   (`fence(i) && `funct_3(i) == 'b001)
 `define system(i)   (`op(i) == SYSTEM)
+`define custom(i)   (`op(i) == CUSTOM && XFIX)
 	// ALU-specific decoders.
 	// "s" stands for simple — every I operation.
 	// "m" stands for multiplication — every Zmmul operation.
-`define alurs(i)    (`alur(i) && !i[25])
-`define alurm(i)    (`alur(i) &&  i[25])
+	// "b" stands for bit manipulation — every Zba/Zbb operation.
+`define alurs(i)    (`alur(i) && !i[29] && !i[27] && !i[25])
+`define alurm(i)    (`alur(i) && !i[27] &&  i[25])
+`define alurb(i)    (`alur(i) && (i[29] || i[27]))
+`define aluib(i)    (`alui(i) && i[29] && i[13:12] == 'b01)
 `define alus(i)     (`alui(i) || `alurs(i))
 	// Branch-specific decoders.
 `define bltge(i)    (`branch(i) && i[14])
@@ -80,10 +98,10 @@ module RISCV #(
 `define add(i)      (`alui(i)  && `funct_3(i) == 'b000 || \
                      `alurs(i) && `funct_3(i) == 'b000 && !i[30])
 `define sub(i)      (`alurs(i) && `funct_3(i) == 'b000 &&  i[30])
-`define sl(i)       (`alus(i)  && `funct_3(i) == 'b001)
+`define sl(i)       (`alus(i)  && `funct_3(i) == 'b001 && !i[29])
 `define slt(i)      (`alus(i)  && i[14:13]    == 'b01_)
 `define bxor(i)     (`alus(i)  && `funct_3(i) == 'b100)
-`define sr(i)       (`alus(i)  && `funct_3(i) == 'b101)
+`define sr(i)       (`alus(i)  && `funct_3(i) == 'b101 && !i[29])
 `define bor(i)      (`alus(i)  && `funct_3(i) == 'b110)
 `define band(i)     (`alus(i)  && `funct_3(i) == 'b111)
 	// M-specific decoders.
@@ -94,12 +112,33 @@ module RISCV #(
 `define mulhu(i)    (`alurm(i) && !i[14] && i[13:12] == 'b11)
 `define div(i)      (`alurm(i) && i[14:13] == 'b10)
 `define rem(i)      (`alurm(i) && i[14:13] == 'b11)
+	// Zba/Zbb-specific decoders.
+	// andn/orn/xnor are decoded as and/or/xor with an inverted operand.
+`define invert(i)   (`alurs(i) && i[30] && i[14] && `funct_3(i) != 'b101)
+`define shadd(i)    (`alurb(i) && `funct_7(i) == 'b0010000)
+`define minmax(i)   (`alurb(i) && `funct_7(i) == 'b0000101)
+`define zexth(i)    (`alurb(i) && `funct_7(i) == 'b0000100)
+`define rol(i)      (`alurb(i) && `funct_7(i) == 'b0110000 && !i[14])
+`define ror(i)      (`alurb(i) && `funct_7(i) == 'b0110000 &&  i[14] || \
+                     `aluib(i) && `funct_7(i) == 'b0110000 &&  i[14])
+`define clz(i)      (`aluib(i) && `funct_12(i) == 'h600 && !i[14])
+`define ctz(i)      (`aluib(i) && `funct_12(i) == 'h601 && !i[14])
+`define cpop(i)     (`aluib(i) && `funct_12(i) == 'h602 && !i[14])
+`define sextb(i)    (`aluib(i) && `funct_12(i) == 'h604 && !i[14])
+`define sexth(i)    (`aluib(i) && `funct_12(i) == 'h605 && !i[14])
+`define orcb(i)     (`aluib(i) && `funct_12(i) == 'h287 &&  i[14])
+`define rev8(i)     (`aluib(i) && `funct_12(i) == 'h698 &&  i[14])
+	// Xfix-specific decoders (custom-0, R-type).
+	// fdot is fmul loading the accumulator, so fdot/fmac/fmac... is a dot product.
+`define fmul(i)     (`custom(i) && `funct_3(i) == 'b000)
+`define fmac(i)     (`custom(i) && `funct_3(i) == 'b001)
+`define fdot(i)     (`custom(i) && `funct_3(i) == 'b010)
 	// Zicsr-specific decoders.
 `define csrrx(i)    (`system(i) && `funct_3(i))
 
 	// Helpers to test if an instruction writes to/reads from a register.
-`define uses_rs_2(i)    i[5]
-`define uses_rd(i)      (!`branch(i) && !`store(i))
+`define uses_rs_2(i)    (i[5] || `custom(i))
+`define uses_rd(i)      (!`branch(i) && !`store(i) && !`fence(i))
 `define write_back(i)   (`uses_rd(i) && `rd(i))
 
 
@@ -145,7 +184,8 @@ module RISCV #(
 
 	wire stall_decode =
 		   stall_execute && decoded
-		|| conflict_execute && cannot_forward_execute;
+		|| conflict_execute && cannot_forward_execute
+		|| drain_queue && decoded;
 
 	wire stall_execute =
 		   await_memory && !data_ack
@@ -184,24 +224,20 @@ module RISCV #(
 
 
 
-	// A memory operation is ongoing.
+	// A load is ongoing.
 	bit await_memory;
 
 	// Sub-word offset.
 	wire[1:0] offset;
 
-	assign { addr, offset } =
+	wire[ADDR_BITS-1:0] decode_addr;
+
+	assign { decode_addr, offset } =
 		store ?        uleft + `s(decode_inst)   :
 		/* load ? */   uleft + `i(decode_inst);
 
-	assign write = store;
-
 /////////////////// UGLY BLOCK INCOMING /////////////////////////////////
-	assign data_strobe =
-		   data_retry
-		|| (load || store) && decoded && !stall_decode && !warp;
-
-	assign data_out =
+	wire[31:0] decode_data =
 		('b00 == decode_inst[13:12] && offset[1:0] == 0 ?   uright[7:0]           : 0) |
 		('b00 == decode_inst[13:12] && offset[1:0] == 1 ?   uright[7:0]   << 8    : 0) |
 		('b00 == decode_inst[13:12] && offset[1:0] == 2 ?   uright[7:0]   << 16   : 0) |
@@ -210,7 +246,7 @@ module RISCV #(
 		('b01 == decode_inst[13:12] &&   offset[1] ?        uright[31:16] << 16   : 0) |
 		('b10 == decode_inst[13:12] ?                       uright                : 0);
 
-	assign select =
+	wire[3:0] decode_select =
 		('b00 == decode_inst[13:12] && offset[1:0] == 0 ?   'b0001   : 0) |
 		('b00 == decode_inst[13:12] && offset[1:0] == 1 ?   'b0010   : 0) |
 		('b00 == decode_inst[13:12] && offset[1:0] == 2 ?   'b0100   : 0) |
@@ -218,6 +254,100 @@ module RISCV #(
 		('b01 == decode_inst[13:12] &&  !offset[1] ?        'b0011   : 0) |
 		('b01 == decode_inst[13:12] &&   offset[1] ?        'b1100   : 0) |
 		('b10 == decode_inst[13:12] ?                       'b1111   : 0);
+/////////////////////////////////////////////////////////////////////////
+
+	//
+	// Stores are posted: they retire as soon as they enter the store queue,
+	// and the queue strobes one of them per cycle without waiting for the
+	// previous one to be acknowledged.
+	//
+	// Every strobe must be answered with either `data_ack` or `data_retry`
+	// exactly one cycle later. A retry rewinds the queue to its oldest entry,
+	// which is the one that got rejected, and nothing else is strobed in
+	// that same cycle so later stores never overtake it.
+	//
+	// Loads and fences drain the queue before they are allowed to proceed.
+	//
+
+	bit[ADDR_BITS-1:0] queue_addr[STORE_SLOTS];
+	bit[31:0] queue_data[STORE_SLOTS];
+	bit[3:0] queue_select[STORE_SLOTS];
+
+	// The extra bit tells a full queue apart from an empty one.
+	bit[SLOT_BITS:0]
+		queue_head = 0,
+		queue_next = 0,
+		queue_tail = 0;
+
+	bit queue_strobed = 0;
+
+	wire[SLOT_BITS-1:0]
+		next_slot = queue_next,
+		tail_slot = queue_tail;
+
+	wire
+		queue_empty = queue_head == queue_tail,
+		queue_full  = queue_tail - queue_head == STORE_SLOTS;
+
+	wire
+		queue_ack   = queue_strobed && data_ack,
+		queue_retry = queue_strobed && data_retry;
+
+	wire drain_queue =
+		   (load || fence) && !queue_empty
+		|| store && queue_full;
+
+	wire
+		push_store = store && decoded && !stall_decode && !warp,
+		issue_load = load  && decoded && !stall_decode && !warp,
+		retry_load = !queue_strobed && data_retry,
+		send_store = queue_next != queue_tail && !queue_retry && !retry_load;
+
+	// Rejected loads are strobed again with the same request.
+	bit[ADDR_BITS-1:0] load_addr;
+	bit[3:0] load_select;
+
+	assign addr =
+		issue_load ?   decode_addr              :
+		retry_load ?   load_addr                :
+		/* else ? */   queue_addr[next_slot];
+
+	assign select =
+		issue_load ?   decode_select            :
+		retry_load ?   load_select              :
+		/* else ? */   queue_select[next_slot];
+
+	assign data_out = queue_data[next_slot];
+	assign write = send_store;
+	assign data_strobe = issue_load || retry_load || send_store;
+
+
+
+	always @(posedge clock) begin
+		queue_strobed <= send_store;
+
+		if (push_store) begin
+			queue_addr[tail_slot] <= decode_addr;
+			queue_data[tail_slot] <= decode_data;
+			queue_select[tail_slot] <= decode_select;
+
+			queue_tail <= queue_tail+1;
+		end
+
+		if (queue_ack)
+			queue_head <= queue_head+1;
+
+		if (queue_retry)
+			queue_next <= queue_head;
+		else if (send_store)
+			queue_next <= queue_next+1;
+
+		if (issue_load) begin
+			load_addr <= decode_addr;
+			load_select <= decode_select;
+		end
+
+	end
 
 	bit access_byte, access_half, access_word;
 	bit[1:0] last_offset;
@@ -340,7 +470,7 @@ module RISCV #(
 	wire conflict_execute = conflict_execute_1 || conflict_execute_2;
 
 	// The executed operation cannot be looped back into the execute stage.
-	wire cannot_forward_execute = await_memory || take_mul || take_mulh;
+	wire cannot_forward_execute = await_memory || take_mul || take_mulh || take_fix;
 
 ///////////////////////////////////////////////////////////////////////
 
@@ -414,9 +544,12 @@ module RISCV #(
 	bit
 		jalr,
 		branch, bltge,
-		load, store,
+		load, store, fence, fencei,
 		add, sub, slt, bxor, bor, band, sl, sr,
 		mul, mulh, mulhs, mulhsu, div, rem,
+		invert, shadd, minmax, zexth, rol, ror,
+		clz, ctz, cpop, sextb, sexth, orcb, rev8,
+		fmul, fmac, fdot,
 		csrrx;
 
 	bit will_write_back;
@@ -478,6 +611,8 @@ module RISCV #(
 			jalr   <= `jalr(fetch_inst);
 			load   <= `load(fetch_inst);
 			store  <= `store(fetch_inst);
+			fence  <= `fence(fetch_inst);
+			fencei <= `fencei(fetch_inst);
 			branch <= `branch(fetch_inst);
 			bltge  <= `bltge(fetch_inst);
 			add    <= `add(fetch_inst);
@@ -494,6 +629,22 @@ module RISCV #(
 			mulhsu <= `mulhsu(fetch_inst);
 			div    <= `div(fetch_inst);
 			rem    <= `rem(fetch_inst);
+			invert <= `invert(fetch_inst);
+			shadd  <= `shadd(fetch_inst);
+			minmax <= `minmax(fetch_inst);
+			zexth  <= `zexth(fetch_inst);
+			rol    <= `rol(fetch_inst);
+			ror    <= `ror(fetch_inst);
+			clz    <= `clz(fetch_inst);
+			ctz    <= `ctz(fetch_inst);
+			cpop   <= `cpop(fetch_inst);
+			sextb  <= `sextb(fetch_inst);
+			sexth  <= `sexth(fetch_inst);
+			orcb   <= `orcb(fetch_inst);
+			rev8   <= `rev8(fetch_inst);
+			fmul   <= `fmul(fetch_inst);
+			fmac   <= `fmac(fetch_inst);
+			fdot   <= `fdot(fetch_inst);
 			csrrx  <= `csrrx(fetch_inst);
 
 			will_write_back <= `write_back(fetch_inst);
@@ -505,14 +656,22 @@ module RISCV #(
 				|| `mulhs(fetch_inst)                      // mulh.
 				|| `mulhsu(fetch_inst)                     // mulhsu.
 				|| `div(fetch_inst) && !fetch_inst[12]     // div.
-				|| `rem(fetch_inst) && !fetch_inst[12];    // rem.
+				|| `rem(fetch_inst) && !fetch_inst[12]     // rem.
+				|| `minmax(fetch_inst) && !fetch_inst[12]  // min/max.
+				|| `fmul(fetch_inst)                       // fmul.
+				|| `fmac(fetch_inst)                       // fmac.
+				|| `fdot(fetch_inst);                      // fdot.
 
 			signed_2 <=
 				   `bltge(fetch_inst) && !fetch_inst[13]   // blt/bge.
 				|| `slt(fetch_inst) && !fetch_inst[12]     // slt.
 				|| `mulhs(fetch_inst)                      // mulh.
 				|| `div(fetch_inst) && !fetch_inst[12]     // div.
-				|| `rem(fetch_inst) && !fetch_inst[12];    // rem.
+				|| `rem(fetch_inst) && !fetch_inst[12]     // rem.
+				|| `minmax(fetch_inst) && !fetch_inst[12]  // min/max.
+				|| `fmul(fetch_inst)                       // fmul.
+				|| `fmac(fetch_inst)                       // fmac.
+				|| `fdot(fetch_inst);                      // fdot.
 
 			decoded <= 1;
 
@@ -533,10 +692,10 @@ module RISCV #(
 
 	bit executed = 0;
 
+	bit[31:0] execute_pc;
+
 `ifdef DUMP
-	bit[31:0]
-		execute_inst,
-		execute_pc;
+	bit[31:0] execute_inst;
 `endif
 
 	bit[31:0]
@@ -559,7 +718,13 @@ module RISCV #(
 		take_mul,
 		take_mulh,
 		take_div,
-		take_rem;
+		take_rem,
+		take_fix,
+		take_mac,
+		take_acc;
+
+	// Dot product accumulator, in 16.32 fixed-point.
+	bit[47:0] accumulator = 0;
 
 	bit[31:0] execute_result;
 	bit[4:0] rd;
@@ -572,6 +737,10 @@ module RISCV #(
 	assign
 		product[63:16] = $signed({ term_4, term_1[31:16] }) + (term_2 + term_3),
 		product[15:0]  =                   term_1[15:0];
+
+	// 16.16 × 16.16 products are 32.32, and get rounded back to 16.16.
+	wire[47:0] fix_sum = product[47:0] + (take_mac ? accumulator : 0);
+	wire[31:0] fix_result = fix_sum[47:16] + fix_sum[15];
 /////////////////////////////////////////////////////////////////////////
 
 	// Value to be written back, according to the kind of instruction executed.
@@ -583,7 +752,8 @@ module RISCV #(
 		| (take_mul ?       product[31:0]    : 0)
 		| (take_mulh ?      product[63:32]   : 0)
 		| (take_div ?       (div_sign ? -quotient : quotient)         : 0)
-		| (take_rem ?       (div_sign ? -dividend : quotient)         : 0);
+		| (take_rem ?       (div_sign ? -dividend : quotient)         : 0)
+		| (take_fix ?       fix_result                                : 0);
 
 	wire branch_result =
 		bltge ?         sleft <  sright   :
@@ -604,6 +774,85 @@ module RISCV #(
 
 	bit div_sign;
 
+	// Second operand of the logic operations, inverted for andn/orn/xnor.
+	wire[31:0] logic_right = invert ? ~uright : uright;
+
+	// Bit 13 tells max/maxu apart from min/minu.
+	wire take_right = (sleft < sright) ^ !decode_inst[13];
+
+	wire[63:0]
+		rotated_left  = { uleft, uleft } << uright[4:0],
+		rotated_right = { uleft, uleft } >> uright[4:0];
+
+	//
+	// Counts are built as trees, to keep them shallow next to the rest of the
+	// execute stage. Zeros are found by halving the search five times, and
+	// bits set by adding neighbouring fields in five levels.
+	//
+
+	function automatic bit[5:0] leading_zeros(input bit[31:0] val);
+		bit[31:0] rest;
+
+		rest = val;
+		leading_zeros = 0;
+
+		for (int step = 16; step > 0; step /= 2)
+			if (!(rest >> 32 - step)) begin
+				leading_zeros |= step;
+				rest <<= step;
+			end
+
+		if (!val)
+			leading_zeros = 32;
+
+	endfunction
+
+	function automatic bit[5:0] trailing_zeros(input bit[31:0] val);
+		bit[31:0] rest;
+
+		rest = val;
+		trailing_zeros = 0;
+
+		for (int step = 16; step > 0; step /= 2)
+			if (!(rest << 32 - step)) begin
+				trailing_zeros |= step;
+				rest >>= step;
+			end
+
+		if (!val)
+			trailing_zeros = 32;
+
+	endfunction
+
+	function automatic bit[5:0] population(input bit[31:0] val);
+		bit[31:0]
+			sum_2,
+			sum_4,
+			sum_8,
+			sum_16;
+
+		for (int pos = 0; pos < 32; pos += 2)
+			sum_2[pos +: 2] = val[pos] + val[pos + 1];
+
+		for (int pos = 0; pos < 32; pos += 4)
+			sum_4[pos +: 4] = sum_2[pos +: 2] + sum_2[pos + 2 +: 2];
+
+		for (int pos = 0; pos < 32; pos += 8)
+			sum_8[pos +: 8] = sum_4[pos +: 4] + sum_4[pos + 4 +: 4];
+
+		for (int pos = 0; pos < 32; pos += 16)
+			sum_16[pos +: 16] = sum_8[pos +: 8] + sum_8[pos + 8 +: 8];
+
+		population = sum_16[15:0] + sum_16[31:16];
+
+	endfunction
+
+	function automatic bit[31:0] or_combine(input bit[31:0] val);
+		for (int pos = 0; pos < 32; pos += 8)
+			or_combine[pos +: 8] = val[pos +: 8] ? 'hFF : 'h00;
+
+	endfunction
+
 
 
 	always @(posedge clock)
@@ -627,9 +876,10 @@ module RISCV #(
 			// Do nothing...
 
 		end else if (decoded && !stall_decode) begin
+			execute_pc <= decode_pc;
+
 `ifdef DUMP
 			execute_inst <= decode_inst;
-			execute_pc <= decode_pc;
 `endif
 
 		// SystemVerilog makes things too verbose...
@@ -655,17 +905,32 @@ module RISCV #(
 			take_mulh <= mulh;
 			take_div <= div;
 			take_rem <= rem;
+			take_fix <= fmul || fmac || fdot;
+			take_mac <= fmac;
+			take_acc <= fmac || fdot;
 
 			execute_result <=
 				   decode_result
 				| (add ?      uleft  +  uright        : 0)
 				| (sub ?      sleft  -  sright        : 0)
 				| (slt ?     (sleft  -  sright) < 0   : 0)
-				| (bxor ?     uleft  ^  uright        : 0)
-				| (bor ?      uleft  |  uright        : 0)
-				| (band ?     uleft  &  uright        : 0)
+				| (bxor ?     uleft  ^  logic_right   : 0)
+				| (bor ?      uleft  |  logic_right   : 0)
+				| (band ?     uleft  &  logic_right   : 0)
 				| (sl ?       uleft <<  uright[4:0]   : 0)
 				| (sr ?       sleft >>> uright[4:0]   : 0)
+				| (shadd ?   (uleft << decode_inst[14:13]) + uright            : 0)
+				| (minmax ?   (take_right ? uright : uleft)                    : 0)
+				| (zexth ?    32'(uleft[15:0])                                 : 0)
+				| (sextb ?    32'($signed(uleft[7:0]))                         : 0)
+				| (sexth ?    32'($signed(uleft[15:0]))                        : 0)
+				| (rol ?      rotated_left[63:32]                              : 0)
+				| (ror ?      rotated_right[31:0]                              : 0)
+				| (clz ?      leading_zeros(uleft)                             : 0)
+				| (ctz ?      trailing_zeros(uleft)                            : 0)
+				| (cpop ?     population(uleft)                                : 0)
+				| (orcb ?     or_combine(uleft)                                : 0)
+				| (rev8 ?     { uleft[7:0], uleft[15:8], uleft[23:16], uleft[31:24] }   : 0)
 				| (csrrx ?       value_csr            : 0);
 
 			rd <= `rd(decode_inst);
@@ -677,7 +942,7 @@ module RISCV #(
 				/* else ? */        decode_pc + `b(decode_inst);
 
 			warp <= jalr || branch && branch_mistaken;
-			await_memory <= load || store;
+			await_memory <= load;
 			executed <= 1;
 
 		end else begin
@@ -707,14 +972,24 @@ module RISCV #(
 
 
 
+	assign
+		retire    = executed && !stall_execute,
+		retire_pc = execute_pc,
+		flush     = retire && fencei;
+
+
+
 	always @(posedge clock)
 
-		if (executed && !stall_execute) begin
+		if (retire) begin
 			if (write_back)
 				registers[rd] <= final_value;
 
 			instret <= instret+1;
 
+			if (take_acc)
+				accumulator <= fix_sum;
+
 `ifdef DUMP
 			save_inst <= execute_inst;
 			save_pc <= execute_pc;
@@ -823,11 +1098,16 @@ module RISCV #(
 `undef store
 `undef alui
 `undef alur
+`undef fence
+`undef fencei
 `undef alu
 `undef system
+`undef custom
 
 `undef alurs
 `undef alurm
+`undef alurb
+`undef aluib
 `undef alus
 
 `undef beqne
@@ -846,6 +1126,24 @@ module RISCV #(
 `undef mulhs
 `undef mulhsu
 `undef mulhu
+`undef div
+`undef rem
+`undef invert
+`undef shadd
+`undef minmax
+`undef zexth
+`undef rol
+`undef ror
+`undef clz
+`undef ctz
+`undef cpop
+`undef sextb
+`undef sexth
+`undef orcb
+`undef rev8
+`undef fmul
+`undef fmac
+`undef fdot
 `undef csrrx
 
 `undef uses_rs_1
@@ -0,0 +1,244 @@
+module SDRAM #(
+	parameter
+		BANK_BITS = 2,
+		ROW_BITS  = 13,
+		COL_BITS  = 9,
+
+		// Timings, in clock cycles.
+		T_INIT    = 20_700,   // 200 µs.
+		T_REFI    = 780,      // 7.8 µs.
+		T_RFC     = 7,
+		T_RCD     = 2,
+		T_RP      = 2,
+		T_WR      = 2,
+		T_MRD     = 2,
+		CAS       = 3,
+
+	localparam
+		// 32-bit words, stored as pairs of 16-bit halves.
+		ADDR_BITS = BANK_BITS + ROW_BITS + COL_BITS - 1
+) (
+	input wire                 clock,
+
+	// Memory port.
+	// Requests are held until `done`. Reads fetch a whole line, with each
+	// of its words pulsing `valid`. Writes store a single word.
+	input wire[ADDR_BITS-1:0]  addr,
+	input wire[31:0]           in,
+	output bit[31:0]           out,
+	input wire[3:0]            select,
+	input wire                 read,
+	input wire                 write,
+	output bit                 valid = 0,
+	output bit                 done = 0,
+
+	// Chip pins.
+	output wire                sdram_clock,
+	output bit                 sdram_cke = 0,
+	output bit                 sdram_cs_ = 1,
+	output bit                 sdram_ras_ = 1,
+	output bit                 sdram_cas_ = 1,
+	output bit                 sdram_we_ = 1,
+	output bit[BANK_BITS-1:0]  sdram_ba = 0,
+	output bit[ROW_BITS-1:0]   sdram_a = 0,
+	output bit[1:0]            sdram_dm = 'b11,
+	inout wire[15:0]           sdram_dq
+);
+
+	//
+	// Every access opens its row, issues a single READ/WRITE with auto
+	// precharge and waits for the bank to close again. Reads use 8-beat
+	// bursts, which fill a 4-word line, and writes are single-beat.
+	//
+	// The chip samples on the falling edge of `clock`, halfway through the
+	// command and data driven on its rising edge.
+	//
+
+	// Commands, as { cs_, ras_, cas_, we_ }.
+	localparam
+		C_NOP       = 'b0111,
+		C_ACTIVE    = 'b0011,
+		C_READ      = 'b0101,
+		C_WRITE     = 'b0100,
+		C_PRECHARGE = 'b0010,
+		C_REFRESH   = 'b0001,
+		C_MODE      = 'b0000;
+
+	// Burst of 8, sequential, CAS latency, single-location writes.
+	localparam bit[ROW_BITS-1:0] MODE = 'b1_00_000_0_011 | CAS << 4;
+
+	typedef enum bit[3:0] {
+		S_POWER_UP,
+		S_INIT_PRECHARGE,
+		S_INIT_REFRESH_1,
+		S_INIT_REFRESH_2,
+		S_INIT_MODE,
+		S_IDLE,
+		S_READ,
+		S_READ_BURST,
+		S_WRITE_LO,
+		S_WRITE_HI,
+		S_RECOVER
+	} State;
+
+	State state = S_POWER_UP;
+
+	// Cycles left before the current state may proceed.
+	bit[$clog2(T_INIT)-1:0] delay = T_INIT;
+
+	bit[$clog2(T_REFI)-1:0] refresh_timer = T_REFI;
+	bit refresh_due = 0;
+
+	bit[2:0] beat;
+
+	bit dq_drive = 0;
+	bit[15:0] dq_out;
+	bit[15:0] dq_in;
+
+	wire[BANK_BITS-1:0] bank = addr[COL_BITS-1 +: BANK_BITS];
+	wire[ROW_BITS-1:0] row = addr[ADDR_BITS-1 -: ROW_BITS];
+	wire[COL_BITS-1:0] col = { addr[COL_BITS-2:0], 1'b0 };
+
+	assign sdram_dq = dq_drive ? dq_out : 'z;
+
+`ifdef ECP5
+	ODDRX1F clock_out(
+		.SCLK(clock),
+		.RST(0),
+		.D0(0),
+		.D1(1),
+		.Q(sdram_clock)
+	);
+`else
+	assign sdram_clock = !clock;
+`endif
+
+`define command(c)   { sdram_cs_, sdram_ras_, sdram_cas_, sdram_we_ } <= c
+
+	always @(posedge clock) begin
+		dq_in <= sdram_dq;
+
+		if (!refresh_timer) begin
+			refresh_timer <= T_REFI;
+			refresh_due <= 1;
+
+		end else
+			refresh_timer <= refresh_timer-1;
+
+	end
+
+	always @(posedge clock) begin
+		`command(C_NOP);
+		dq_drive <= 0;
+		valid <= 0;
+		done <= 0;
+
+		if (delay)
+			delay <= delay-1;
+
+		else case (state)
+
+		S_POWER_UP: begin
+			sdram_cke <= 1;
+			delay <= T_RP;
+			state <= S_INIT_PRECHARGE;
+		end
+
+		S_INIT_PRECHARGE: begin
+			`command(C_PRECHARGE);
+			// All banks.
+			sdram_a[10] <= 1;
+			delay <= T_RP;
+			state <= S_INIT_REFRESH_1;
+		end
+
+		S_INIT_REFRESH_1: begin
+			`command(C_REFRESH);
+			delay <= T_RFC;
+			state <= S_INIT_REFRESH_2;
+		end
+
+		S_INIT_REFRESH_2: begin
+			`command(C_REFRESH);
+			delay <= T_RFC;
+			state <= S_INIT_MODE;
+		end
+
+		S_INIT_MODE: begin
+			`command(C_MODE);
+			sdram_ba <= 0;
+			sdram_a <= MODE;
+			delay <= T_MRD;
+			state <= S_IDLE;
+		end
+
+		S_IDLE:
+			if (refresh_due) begin
+				`command(C_REFRESH);
+				refresh_due <= 0;
+				delay <= T_RFC;
+
+			end else if (read || write) begin
+				`command(C_ACTIVE);
+				sdram_ba <= bank;
+				sdram_a <= row;
+				delay <= T_RCD;
+				state <= read ? S_READ : S_WRITE_LO;
+			end
+
+		S_READ: begin
+			`command(C_READ);
+			sdram_a <= 1 << 10 | col & ~'b111;
+			sdram_dm <= 0;
+			beat <= 0;
+			// The first beat gets registered into `dq_in` CAS cycles later.
+			delay <= CAS;
+			state <= S_READ_BURST;
+		end
+
+		S_READ_BURST: begin
+			if (beat[0])
+				out[31:16] <= dq_in;
+			else
+				out[15:0] <= dq_in;
+
+			valid <= beat[0];
+			beat <= beat+1;
+
+			if (beat == 7) begin
+				done <= 1;
+				delay <= T_RP;
+				state <= S_RECOVER;
+			end
+		end
+
+		S_WRITE_LO: begin
+			`command(C_WRITE);
+			sdram_a <= col;
+			sdram_dm <= ~select[1:0];
+			dq_out <= in[15:0];
+			dq_drive <= 1;
+			state <= S_WRITE_HI;
+		end
+
+		S_WRITE_HI: begin
+			`command(C_WRITE);
+			sdram_a <= 1 << 10 | col | 1;
+			sdram_dm <= ~select[3:2];
+			dq_out <= in[31:16];
+			dq_drive <= 1;
+			done <= 1;
+			delay <= T_WR + T_RP;
+			state <= S_RECOVER;
+		end
+
+		S_RECOVER:
+			state <= S_IDLE;
+
+		endcase
+
+	end
+
+`undef command
+
+endmodule
@@ -1,3 +1,5 @@
+// Test knobs for `BRAM`. PING_PONG_* retry every other strobe. DELAY_* answer
+// late, which the data bus no longer allows, so they stop the build.
 // `define DELAY_1_1
 // `define DELAY_1_5
 // `define DELAY_2_2
@@ -6,9 +8,36 @@
 // `define PING_PONG_1
 // `define PING_PONG_2
 
+// SCALE=2 does not fit the 25k part, which has 56 EBRs. The 320x200 frame
+// takes 32 of them even as INDEXED, next to 16 for the RAM and 16 for the
+// 18-bit atlas words.
+`ifndef SCALE
+`define SCALE   4
+`endif
+
+`ifndef PIXEL
+`define PIXEL   "RGB666"
+`endif
+
+`ifndef XFIX
+`define XFIX    1
+`endif
+
+`ifndef ATLAS
+`define ATLAS   "build/res/dingus_nowhiskers.666.hex"
+`endif
+
+// Only indexed atlases need their palette.
+`ifndef SWATCH
+`define SWATCH  'x
+`endif
+
 `include "rtl/types.svh"
 `include "rtl/BRAM_delayed_ports.sv"
+`include "rtl/Cache.sv"
+`include "rtl/Profiler.sv"
 `include "rtl/RISCV.sv"
+`include "rtl/SDRAM.sv"
 `include "rtl/UART.sv"
 `include "rtl/Video_reborn.sv"
 
@@ -21,7 +50,19 @@ module SoC(
 	input wire       icelink_rx,
 
 	// 4×PMOD
-	output wire[15:0] port_2
+	output wire[15:0] port_2,
+
+	// SDRAM
+	output wire       sdram_clock,
+	output wire       sdram_cke,
+	output wire       sdram_cs_,
+	output wire       sdram_ras_,
+	output wire       sdram_cas_,
+	output wire       sdram_we_,
+	output wire[1:0]  sdram_ba,
+	output wire[12:0] sdram_a,
+	output wire[1:0]  sdram_dm,
+	inout wire[15:0]  sdram_dq
 );
 
 `ifndef DUMP
@@ -53,6 +94,21 @@ module SoC(
 	wire[31:0] inst_in;
 	wire inst_strobe, inst_ack, inst_retry;
 
+	// Instruction bus
+	wire[31:0] ram_inst, icache_inst;
+	wire ram_inst_ack, icache_inst_ack;
+	wire ram_inst_retry, icache_inst_retry;
+	bit from_icache;
+
+	wire fetch_sdram = 'b011 == next_pc[29:27];
+
+	assign inst_in = from_icache ? icache_inst : ram_inst;
+	assign inst_ack = ram_inst_ack || icache_inst_ack;
+	assign inst_retry = ram_inst_retry || icache_inst_retry;
+
+	always @(posedge bus_clock) if (inst_strobe)
+		from_icache <= fetch_sdram;
+
 	// Data port
 	wire[27:0] addr;
 	wire[31:0] cpu_in, cpu_out;
@@ -60,33 +116,49 @@ module SoC(
 	wire write, data_strobe, data_ack, data_retry;
 
 	// Data bus
-	wire[31:0] ram_out, icelink_out, video_out;
-	wire ram_ack, icelink_ack, video_ack;
-	wire ram_retry, icelink_retry, video_retry;
-	bit from_ram, from_icelink, from_video;
+	//
+	// The CPU may strobe once per cycle without waiting for the previous
+	// answer, so every slave must acknowledge or retry each strobe exactly
+	// one cycle after it. A slave that needs longer has to retry and be
+	// strobed again.
+	//
+	wire[31:0] ram_out, profiler_out, dcache_out, icelink_out, video_out;
+	wire ram_ack, profiler_ack, dcache_ack, icelink_ack, video_ack;
+	wire ram_retry, profiler_retry, dcache_retry, icelink_retry, video_retry;
+	bit from_ram, from_profiler, from_dcache, from_icelink, from_video;
 
 	wire
-		to_ram     = 'b00 == addr[27:26],
-		to_icelink = 'b10 == addr[27:26],
-		to_video   = 'b11 == addr[27:26];
+		to_ram      = 'b00 == addr[27:26],
+		to_profiler = 'b01 == addr[27:26] && !addr[25],
+		to_dcache   = 'b01 == addr[27:26] &&  addr[25],
+		to_icelink  = 'b10 == addr[27:26],
+		to_video    = 'b11 == addr[27:26];
 
 	assign cpu_in =
-		  (from_ram ?       ram_out       : 0)
-		| (from_icelink ?   icelink_out   : 0)
-		| (from_video ?     video_out     : 0);
+		  (from_ram ?        ram_out        : 0)
+		| (from_profiler ?   profiler_out   : 0)
+		| (from_dcache ?     dcache_out     : 0)
+		| (from_icelink ?    icelink_out    : 0)
+		| (from_video ?      video_out      : 0);
 
 	assign data_ack =
 		ram_ack ||
+		profiler_ack ||
+		dcache_ack ||
 		icelink_ack ||
 		video_ack;
 
 	assign data_retry =
 		ram_retry ||
+		profiler_retry ||
+		dcache_retry ||
 		icelink_retry ||
 		video_retry;
 
 	always @(posedge bus_clock) if (data_strobe) begin
 		from_ram <= to_ram;
+		from_profiler <= to_profiler;
+		from_dcache <= to_dcache;
 		from_icelink <= to_icelink;
 		from_video <= to_video;
 
@@ -100,12 +172,12 @@ module SoC(
 	) ram(
 		.clock_1(bus_clock),
 		.addr_1(next_pc[13:2]),
-		.out_1(inst_in),
+		.out_1(ram_inst),
 		.write_1(0),
 		.select_1('b1111),
-		.strobe_1(inst_strobe),
-		.ack_1(inst_ack),
-		.retry_1(inst_retry),
+		.strobe_1(inst_strobe && !fetch_sdram),
+		.ack_1(ram_inst_ack),
+		.retry_1(ram_inst_retry),
 
 		.clock_2(bus_clock),
 		.addr_2(addr[25:0]),
@@ -118,6 +190,128 @@ module SoC(
 		.retry_2(ram_retry)
 	);
 
+	// SDRAM, at 0x18000000.
+	wire[22:0] icache_addr, dcache_addr;
+	wire[31:0] dcache_data;
+	wire[3:0] dcache_select;
+	wire icache_read, dcache_read, dcache_write;
+
+	// Retired a fence.i.
+	wire flush;
+
+	wire[31:0] sdram_out;
+	wire sdram_valid, sdram_done;
+
+	// A request keeps the controller until it is done.
+	// The data cache goes first, as the instruction cache is usually hit.
+	bit sdram_granted = 0;
+	bit sdram_to_dcache;
+
+	wire
+		icache_valid = sdram_valid && sdram_granted && !sdram_to_dcache,
+		icache_done  = sdram_done  && sdram_granted && !sdram_to_dcache,
+		dcache_valid = sdram_valid && sdram_granted &&  sdram_to_dcache,
+		dcache_done  = sdram_done  && sdram_granted &&  sdram_to_dcache;
+
+	always @(posedge bus_clock)
+		if (!sdram_granted) begin
+			sdram_granted <= dcache_read || dcache_write || icache_read;
+			sdram_to_dcache <= dcache_read || dcache_write;
+
+		end else if (sdram_done)
+			sdram_granted <= 0;
+
+	Cache #(
+		.ADDR_BITS(23)
+	) icache(
+		.clock(bus_clock),
+		.addr(next_pc[24:2]),
+		.in(0),
+		.out(icache_inst),
+		.select('b1111),
+		.write(0),
+		.strobe(inst_strobe && fetch_sdram),
+		.ack(icache_inst_ack),
+		.retry(icache_inst_retry),
+
+		// Code written through the data cache shows up after a fence.i.
+		.invalidate(flush),
+
+		.mem_addr(icache_addr),
+		.mem_in(sdram_out),
+		.mem_read(icache_read),
+		.mem_valid(icache_valid),
+		.mem_done(icache_done)
+	);
+
+	Cache #(
+		.ADDR_BITS(23)
+	) dcache(
+		.clock(bus_clock),
+		.addr(addr[22:0]),
+		.in(cpu_out),
+		.out(dcache_out),
+		.select,
+		.write,
+		.strobe(data_strobe && to_dcache),
+		.ack(dcache_ack),
+		.retry(dcache_retry),
+
+		// Every write goes through it, so it never holds stale data.
+		.invalidate(0),
+
+		.mem_addr(dcache_addr),
+		.mem_in(sdram_out),
+		.mem_out(dcache_data),
+		.mem_select(dcache_select),
+		.mem_read(dcache_read),
+		.mem_write(dcache_write),
+		.mem_valid(dcache_valid),
+		.mem_done(dcache_done)
+	);
+
+	SDRAM sdram(
+		.clock(bus_clock),
+		.addr(sdram_to_dcache ? dcache_addr : icache_addr),
+		.in(dcache_data),
+		.out(sdram_out),
+		.select(dcache_select),
+		.read(sdram_granted && (sdram_to_dcache ? dcache_read : icache_read)),
+		.write(sdram_granted && sdram_to_dcache && dcache_write),
+		.valid(sdram_valid),
+		.done(sdram_done),
+
+		.sdram_clock,
+		.sdram_cke,
+		.sdram_cs_,
+		.sdram_ras_,
+		.sdram_cas_,
+		.sdram_we_,
+		.sdram_ba,
+		.sdram_a,
+		.sdram_dm,
+		.sdram_dq
+	);
+
+	// Retirement trace.
+	wire retire;
+	wire[31:0] retire_pc;
+
+	Profiler profiler(
+		.clock(bus_clock),
+		.retire,
+		.retire_pc,
+
+		.addr,
+		.in(cpu_out),
+		.out(profiler_out),
+		.write,
+		.select(|select),
+		.strobe(data_strobe && to_profiler),
+		.ack(profiler_ack),
+		.retry(profiler_retry)
+	);
+
 	UART #(
 		.WORD_BITS(32)
 	) icelink(
@@ -139,7 +333,10 @@ module SoC(
 		.BYTE_BITS(8),
 		.BYTES_PER_WORD(4),
 
-		.ATLAS("build/res/dingus_nowhiskers.666.hex"),
+		.SCALE(`SCALE),
+		.PIXEL(`PIXEL),
+		.ATLAS(`ATLAS),
+		.SWATCH(`SWATCH),
 		// The board clock is slightly slower than the VGA standard dictates.
 		// Making the vertical blanking interval shorter compensates that.
 		.V_FP(9),
@@ -162,7 +359,8 @@ module SoC(
 	);
 
 	RISCV #(
-		.ADDR_BITS(28)
+		.ADDR_BITS(28),
+		.XFIX(`XFIX)
 	) cpu(
 		.clock(bus_clock),
 		.next_pc,
@@ -178,7 +376,11 @@ module SoC(
 		.write,
 		.data_strobe,
 		.data_ack,
-		.data_retry
+		.data_retry,
+
+		.retire,
+		.retire_pc,
+		.flush
 	);
 
 endmodule
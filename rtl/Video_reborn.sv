@@ -4,7 +4,9 @@ module Video #(
 		BYTES_PER_WORD,
 
 		SCALE   = 4,
+		PIXEL   = "RGB666",
 		ATLAS   = 'x,
+		SWATCH  = 'x,
 		ATLAS_W = 128,
 		ATLAS_H = 128,
 		FRAME_W = 640,
@@ -23,6 +25,12 @@ module Video #(
 		F_Y_BITS    = $clog2(FRAME_H),
 		F_NUM_WORDS = FRAME_W/SCALE * FRAME_H/SCALE,
 		F_ADDR_BITS = $clog2(F_NUM_WORDS),
+		F_BYTE_BITS = PIXEL == "RGB444" ? 4 : PIXEL == "INDEXED" ? 8 : 6,
+		F_BYTES     = PIXEL == "INDEXED" ? 1 : 3,
+		F_WORD_BITS = F_BYTE_BITS * F_BYTES,
+
+		P_NUM_WORDS = 256,
+		P_ADDR_BITS = $clog2(P_NUM_WORDS),
 
 		A_X_BITS    = $clog2(ATLAS_W),
 		A_Y_BITS    = $clog2(ATLAS_H),
@@ -30,7 +38,9 @@ module Video #(
 		A_ADDR_BITS = $clog2(A_NUM_WORDS),
 
 		WORD_BITS   = BYTE_BITS * BYTES_PER_WORD,
-		ADDR_BITS   = $clog2(F_NUM_WORDS | A_NUM_WORDS) + 2
+		// Windows span at least 64 Ki words, so that their base addresses do
+		// not move around when changing the framebuffer format.
+		ADDR_BITS   = $clog2(F_NUM_WORDS | A_NUM_WORDS | 'hFFFF) + 2
 ) (
 	input wire                     beam_clock,
 	output wire RGB_666            color,
@@ -61,25 +71,69 @@ module Video #(
 		sync_0;
 
 	bit inside_border;
+	wire[F_WORD_BITS-1:0] beam_pixel;
 	wire RGB_666 beam_color;
 
+	wire border_0 =
+		   beam_x == 0
+		|| beam_y == 0
+		|| beam_x == FRAME_W - 1
+		|| beam_y == FRAME_H - 1;
+
+	// Timing signals delayed to match the latency of the color lookup.
+	wire[1:0]
+		blank_1,
+		sync_1;
+
+	wire border_1;
+
 	assign color =
 		blank ?           0                      :
 		inside_border ?   'b011111_011111_011111 :
 		/* else ? */      beam_color;
 
 	always @(posedge beam_clock) begin
-		blank <= blank_0;
-		sync <= sync_0;
+		blank <= blank_1;
+		sync <= sync_1;
+		inside_border <= border_1;
+
+	end
+
+	if (PIXEL == "INDEXED") begin
+		// Indexed pixels take an extra cycle to go through the palette.
+		bit[1:0]
+			blank_2,
+			sync_2;
 
-		inside_border <=
-			   beam_x == 0
-			|| beam_y == 0
-			|| beam_x == FRAME_W - 1
-			|| beam_y == FRAME_H - 1;
+		bit border_2;
+
+		assign
+			blank_1  = blank_2,
+			sync_1   = sync_2,
+			border_1 = border_2;
+
+		always @(posedge beam_clock) begin
+			blank_2 <= blank_0;
+			sync_2 <= sync_0;
+			border_2 <= border_0;
+
+		end
+
+	end else begin
+		assign
+			blank_1  = blank_0,
+			sync_1   = sync_0,
+			border_1 = border_0;
 
 	end
 
+	if (PIXEL == "RGB444") begin
+		wire RGB_444 beam_444 = beam_pixel;
+		assign beam_color = `rgb444_to_666(beam_444);
+
+	end else if (PIXEL == "RGB666")
+		assign beam_color = beam_pixel;
+
 	Video_Timing #(
 		.W(FRAME_W),
 		.H(FRAME_H),
@@ -103,11 +157,13 @@ module Video #(
 	// Rasterizer
 	//
 
-	wire rasterizing;
+	wire
+		rasterizing,
+		front_facing;
 
 	wire[F_ADDR_BITS-1:0] pixel_addr;
-	wire[2:0] pixel_select;
-	wire RGB_666 pixel;
+	wire[F_BYTES-1:0] pixel_select;
+	wire[F_WORD_BITS-1:0] pixel;
 
 	wire
 		pixel_write,
@@ -123,8 +179,12 @@ module Video #(
 		texel_ack,
 		texel_retry;
 
+	wire[7:0] swatch_addr;
+	wire RGB_666 swatch;
+
 	Video_Rasterizer #(
 		.SCALE(SCALE),
+		.PIXEL(PIXEL),
 		.FRAME_W(FRAME_W),
 		.FRAME_H(FRAME_H),
 		.ATLAS_W(ATLAS_W),
@@ -132,20 +192,26 @@ module Video #(
 	) rasterizer(
 		.clock(bus_clock),
 
-		.fire(to_fire && strobe && select && write),
+		.fire(cpu_fire),
 		.a_in(a),
 		.b_in(b),
 		.c_in(c),
 		.matrix_in(matrix),
+		.format_in(texel_format),
+		.palette_in(palette_base),
+		.shading_in(shading),
+		.flat_in(flat_color),
 		.busy(rasterizing),
+		.drawn(front_facing),
+		.hold(frame_wait),
 
 		.pixel_addr,
 		.pixel_out(pixel),
 		.pixel_write,
 		.pixel_select,
 		.pixel_strobe,
-		.pixel_ack(frame_ack),
-		.pixel_retry(frame_retry),
+		.pixel_ack(frame_ack && !from_frame),
+		.pixel_retry(frame_retry && !from_frame),
 
 		.texel_addr,
 		.texel_in(texel),
@@ -153,17 +219,26 @@ module Video #(
 		.texel_select,
 		.texel_strobe,
 		.texel_ack,
-		.texel_retry
+		.texel_retry,
+
+		.swatch_addr,
+		.swatch_in(swatch)
 	);
 
 	//
 	// Memory interface
 	//
 
+	// The second half of the atlas window takes words as they are, for
+	// formats other than RGB 6:6:6.
 	wire
-		to_frame   = addr[ADDR_BITS-2],
+		to_frame   = addr[ADDR_BITS-2] && !addr[ADDR_BITS-1],
 		to_atlas   = addr[ADDR_BITS-1],
-		to_mmio    = !to_frame && !to_atlas,
+		to_raw     = addr[ADDR_BITS-2],
+		to_palette = !to_frame && !to_atlas && addr[ADDR_BITS-3:P_ADDR_BITS] == 1
+		             && PIXEL == "INDEXED",
+		to_swatch  = !to_frame && !to_atlas && addr[ADDR_BITS-3:P_ADDR_BITS] == 2,
+		to_mmio    = !to_frame && !to_atlas && !to_palette && !to_swatch,
 
 		to_i_x     = addr == 0,
 		to_i_y     = addr == 1,
@@ -205,54 +280,162 @@ module Video #(
 		to_c_y     = addr == 30,
 		to_c_z     = addr == 31,
 		to_c_u     = addr == 32,
-		to_c_v     = addr == 33;
+		to_c_v     = addr == 33,
+
+		to_format  = addr == 34,
+		to_base    = addr == 35,
+		to_shading = addr == 36,
+		to_color   = addr == 37,
+		to_drawn   = addr == 38;
 
 	bit
 		from_frame,
 		from_atlas,
+		from_raw,
+		from_palette,
+		from_swatch,
 		from_v_blank,
-		from_busy;
+		from_busy,
+		from_format,
+		from_base,
+		from_shading,
+		from_color,
+		from_drawn;
+
+	//
+	// The CPU and the rasterizer share the second framebuffer port. The CPU
+	// gets it whenever the rasterizer is not writing a pixel, and is told to
+	// retry otherwise.
+	//
+	// A rejected access holds the rasterizer back until the CPU is served.
+	// Fragments already in flight keep being written, so the wait is bounded
+	// by the depth of the fragment pipeline rather than the triangle size.
+	//
+
+	wire cpu_frame = strobe && to_frame && !pixel_strobe;
+
+	// Triangles latch their settings when fired, and fragments in flight
+	// still depend on them. Firing while busy is retried until it is safe.
+	wire cpu_fire = strobe && to_fire && select && write && !rasterizing;
+
+	bit fire_taken;
+
+	bit
+		frame_taken,
+		frame_wait = 0;
 
 	assign out =
-		  (from_frame ?     `rgb666_unpack(frame_out)   : 0)
-		| (from_atlas ?     `rgb666_unpack(atlas_out)   : 0)
-		| (from_v_blank ?   blank[1]                    : 0)
-		| (from_busy ?      rasterizing                 : 0);
+		  (from_frame ?     frame_word                    : 0)
+		| (from_atlas ?     atlas_word                    : 0)
+		| (from_palette ?   `rgb666_unpack(palette_out)   : 0)
+		| (from_swatch ?    `rgb666_unpack(swatch_out)    : 0)
+		| (from_format ?    texel_format                  : 0)
+		| (from_base ?      palette_base                  : 0)
+		| (from_shading ?   shading                       : 0)
+		| (from_color ?     `rgb666_unpack(flat_color)    : 0)
+		| (from_drawn ?     drawn                         : 0)
+		| (from_v_blank ?   blank[1]                      : 0)
+		| (from_busy ?      rasterizing                   : 0);
 
 	Mat4 matrix;
 	Vertex a, b, c;
 	bit mmio_ack;
 
+	// Texel format and atlas palette base for the next triangles.
+	bit[1:0] texel_format = 0;
+	bit[7:0] palette_base = 0;
+
+	// Shading mode and flat color for the next triangles.
+	bit[1:0] shading = 0;
+	RGB_666 flat_color = 0;
+
+	// Triangles that were not culled, counting from whatever the CPU wrote.
+	bit[31:0] drawn = 0;
+
 	wire
 		frame_ack,
-		atlas_ack;
+		atlas_ack,
+		palette_ack,
+		swatch_ack;
 
 	wire
 		frame_retry,
-		atlas_retry;
+		atlas_retry,
+		palette_retry,
+		swatch_retry;
 
 	wire RGB_666
 		atlas_out,
-		frame_out;
+		palette_out,
+		swatch_out;
+
+	wire[F_WORD_BITS-1:0] frame_out;
 
+	// Framebuffer contents as seen by the CPU.
+	wire RGB_666 frame_666 = frame_out;
+	wire RGB_444 frame_444 = frame_out;
+
+	wire[F_WORD_BITS-1:0] frame_in =
+		PIXEL == "INDEXED" ?   in[7:0]              :
+		PIXEL == "RGB444" ?    `rgb444_pack(in)     :
+		/* else ? */           `rgb666_pack(in);
+
+	wire[WORD_BITS-1:0] frame_word =
+		PIXEL == "INDEXED" ?   frame_out                     :
+		PIXEL == "RGB444" ?    `rgb444_unpack(frame_444)     :
+		/* else ? */           `rgb666_unpack(frame_666);
+
+	// Atlas contents as seen by the CPU.
+	wire RGB_666 atlas_in =
+		to_raw ?       in[17:0]           :
+		/* else ? */   `rgb666_pack(in);
+
+	wire[WORD_BITS-1:0] atlas_word =
+		from_raw ?     atlas_out                    :
+		/* else ? */   `rgb666_unpack(atlas_out);
+
+	// Every strobe is answered exactly once, on the following cycle.
 	assign ack =
-		   frame_ack && !rasterizing
+		   frame_ack && from_frame
 		|| atlas_ack
+		|| palette_ack
+		|| swatch_ack
 		|| mmio_ack;
 
 	assign retry =
-		   frame_retry && !rasterizing
-		|| from_frame && rasterizing
-		|| atlas_retry;
-
-	always @(posedge bus_clock) if (strobe) begin
-		from_frame <= to_frame;
-		from_atlas <= to_atlas;
-		from_v_blank <= to_v_blank;
-		from_busy <= to_busy;
+		   frame_retry && from_frame
+		|| frame_taken
+		|| fire_taken
+		|| atlas_retry
+		|| palette_retry
+		|| swatch_retry;
+
+	always @(posedge bus_clock) begin
+		from_frame <= cpu_frame;
+		from_atlas <= strobe && to_atlas;
+		from_raw <= strobe && to_raw;
+		from_palette <= strobe && to_palette;
+		from_swatch <= strobe && to_swatch;
+		from_format <= strobe && to_format;
+		from_base <= strobe && to_base;
+		from_shading <= strobe && to_shading;
+		from_color <= strobe && to_color;
+		from_drawn <= strobe && to_drawn;
+		from_v_blank <= strobe && to_v_blank;
+		from_busy <= strobe && to_busy;
+		frame_taken <= strobe && to_frame && pixel_strobe;
+		fire_taken <= strobe && to_fire && write && rasterizing;
+
+		if (cpu_frame)
+			frame_wait <= 0;
+		else if (strobe && to_frame)
+			frame_wait <= 1;
+
+		mmio_ack <= strobe && to_mmio && !(to_fire && write && rasterizing);
 
-		mmio_ack <= to_mmio;
+	end
 
+	always @(posedge bus_clock) if (strobe) begin
 		if (to_i_x) matrix.i.x <= in;
 		if (to_i_y) matrix.i.y <= in;
 		if (to_i_z) matrix.i.z <= in;
@@ -291,29 +474,40 @@ module Video #(
 		if (to_c_u) c.tex.x <= in;
 		if (to_c_v) c.tex.y <= in;
 
+		if (to_format && write) texel_format <= in;
+		if (to_base && write) palette_base <= in;
+		if (to_shading && write) shading <= in;
+		if (to_color && write) flat_color <= `rgb666_pack(in);
+
 	end
 
+	always @(posedge bus_clock)
+		if (strobe && to_drawn && write)
+			drawn <= in;
+		else if (front_facing)
+			drawn <= drawn + 1;
+
 	BRAM #(
 		.NUM_WORDS(F_NUM_WORDS),
-		.BYTE_BITS(6),
-		.BYTES_PER_WORD(3)
+		.BYTE_BITS(F_BYTE_BITS),
+		.BYTES_PER_WORD(F_BYTES)
 	) frame(
 		// Internal port.
 		.clock_1(beam_clock),
 		.addr_1(FRAME_W/SCALE * (beam_y/SCALE) + beam_x/SCALE),
-		.out_1(beam_color),
-		.select_1('b111),
+		.out_1(beam_pixel),
+		.select_1('1),
 		.write_1(0),
 		.strobe_1(1),
 
 		// External port shared with the rasterizer.
 		.clock_2(bus_clock),
-		.addr_2(rasterizing ? pixel_addr : addr[F_ADDR_BITS-1:0]),
-		.in_2(rasterizing ? pixel : `rgb666_pack(in)),
+		.addr_2(cpu_frame ? addr[F_ADDR_BITS-1:0] : pixel_addr),
+		.in_2(cpu_frame ? frame_in : pixel),
 		.out_2(frame_out),
-		.write_2(rasterizing ? pixel_write : write),
-		.select_2(rasterizing ? pixel_select : select),
-		.strobe_2(rasterizing ? pixel_strobe : strobe && to_frame),
+		.write_2(cpu_frame ? write : pixel_write),
+		.select_2(cpu_frame ? select[F_BYTES-1:0] : pixel_select),
+		.strobe_2(cpu_frame || pixel_strobe),
 		.ack_2(frame_ack),
 		.retry_2(frame_retry)
 	);
@@ -337,7 +531,7 @@ module Video #(
 		// External port.
 		.clock_2(bus_clock),
 		.addr_2(addr[A_ADDR_BITS-1:0]),
-		.in_2(`rgb666_pack(in)),
+		.in_2(atlas_in),
 		.out_2(atlas_out),
 		.write_2(write),
 		.select_2(select),
@@ -346,6 +540,66 @@ module Video #(
 		.retry_2(atlas_retry)
 	);
 
+	BRAM #(
+		.FILE(SWATCH),
+		.NUM_WORDS(P_NUM_WORDS),
+		.BYTE_BITS(6),
+		.BYTES_PER_WORD(3)
+	) swatches(
+		// Internal port.
+		.clock_1(bus_clock),
+		.addr_1(swatch_addr),
+		.out_1(swatch),
+		.select_1('b111),
+		.write_1(0),
+		.strobe_1(1),
+
+		// External port.
+		.clock_2(bus_clock),
+		.addr_2(addr[P_ADDR_BITS-1:0]),
+		.in_2(`rgb666_pack(in)),
+		.out_2(swatch_out),
+		.write_2(write),
+		.select_2(select),
+		.strobe_2(strobe && to_swatch),
+		.ack_2(swatch_ack),
+		.retry_2(swatch_retry)
+	);
+
+	if (PIXEL == "INDEXED") begin
+		BRAM #(
+			.NUM_WORDS(P_NUM_WORDS),
+			.BYTE_BITS(6),
+			.BYTES_PER_WORD(3)
+		) palette(
+			// Internal port.
+			.clock_1(beam_clock),
+			.addr_1(beam_pixel),
+			.out_1(beam_color),
+			.select_1('b111),
+			.write_1(0),
+			.strobe_1(1),
+
+			// External port.
+			.clock_2(bus_clock),
+			.addr_2(addr[P_ADDR_BITS-1:0]),
+			.in_2(`rgb666_pack(in)),
+			.out_2(palette_out),
+			.write_2(write),
+			.select_2(select),
+			.strobe_2(strobe && to_palette),
+			.ack_2(palette_ack),
+			.retry_2(palette_retry)
+		);
+
+	end else begin
+		assign
+			palette_out   = 0,
+			palette_ack   = 0,
+			palette_retry = 0;
+
+	end
+
 `ifdef DUMP
 	wire[31:0]
 		matrix_i_x = matrix.i.x,
@@ -388,6 +642,7 @@ endmodule
 module Video_Rasterizer #(
 	parameter
 		SCALE,
+		PIXEL,
 		ATLAS_W,
 		ATLAS_H,
 		FRAME_W,
@@ -395,6 +650,8 @@ module Video_Rasterizer #(
 
 	localparam
 		F_ADDR_BITS = $clog2(FRAME_W/SCALE * FRAME_H/SCALE),
+		F_BYTES     = PIXEL == "INDEXED" ? 1 : 3,
+		F_WORD_BITS = PIXEL == "INDEXED" ? 8 : PIXEL == "RGB444" ? 12 : 18,
 		A_ADDR_BITS = $clog2(ATLAS_W * ATLAS_H)
 ) (
 	input wire                 clock,
@@ -405,14 +662,24 @@ module Video_Rasterizer #(
 	input wire Vertex          b_in,
 	input wire Vertex          c_in,
 	input wire Mat4            matrix_in,
+	input wire[1:0]            format_in,
+	input wire[7:0]            palette_in,
+	input wire[1:0]            shading_in,
+	input wire RGB_666         flat_in,
 	output wire                busy,
 
+	// Pulses when a triangle is found to be front-facing.
+	output bit                 drawn = 0,
+
+	// Stop emitting new fragments.
+	input wire                 hold,
+
 	// Draw memory port.
 	output bit[F_ADDR_BITS:0]  pixel_addr,
 	// input wire RGB_666         pixel_in,
-	output RGB_666             pixel_out,
+	output bit[F_WORD_BITS-1:0] pixel_out,
 	output bit                 pixel_write = 1,
-	output bit[2:0]            pixel_select = 'b111,
+	output bit[F_BYTES-1:0]    pixel_select = '1,
 	output bit                 pixel_strobe = 0,
 	input wire                 pixel_ack,
 	input wire                 pixel_retry,
@@ -425,9 +692,26 @@ module Video_Rasterizer #(
 	output bit[2:0]            texel_select = 'b111,
 	output bit                 texel_strobe = 0,
 	input wire                 texel_ack,
-	input wire                 texel_retry
+	input wire                 texel_retry,
+
+	// Atlas palette port.
+	output wire[7:0]           swatch_addr,
+	input wire RGB_666         swatch_in
 );
 
+	// Texel formats.
+	localparam
+		TEXEL_RGB666   = 0,
+		TEXEL_RGB444   = 1,
+		TEXEL_INDEXED8 = 2,
+		TEXEL_INDEXED4 = 3;
+
+	// Shading modes.
+	localparam
+		SHADE_TEXTURED = 0,
+		SHADE_FLAT     = 1,
+		SHADE_GOURAUD  = 2;
+
 	typedef enum bit[5:0] {
 		S_IDLE,
 
@@ -472,6 +756,9 @@ module Video_Rasterizer #(
 	State state = S_IDLE;
 	assign busy = state != S_IDLE || pixels_in_flight;
 
+	always @(posedge clock)
+		drawn <= state == S_WEIGHT_1 && product_1 > product_2;
+
 
 
 
@@ -483,6 +770,12 @@ module Video_Rasterizer #(
 		b,
 		c;
 
+	bit[1:0] format;
+	bit[7:0] palette;
+
+	bit[1:0] shading;
+	RGB_666 flat;
+
 	// Transformed homogeneous coordinates.
 	Vec4
 		homo_a,
@@ -702,16 +995,27 @@ module Video_Rasterizer #(
 
 	always @(posedge clock) case (state)
 
-		S_IDLE: if (fire) begin
-			color <= color ^ 'hAAA;
+		S_IDLE: begin
+			// The last fragment must not be painted over and over.
+			is_inside <= 0;
 
-			a <= a_in;
-			b <= b_in;
-			c <= c_in;
-			matrix <= matrix_in;
-			next_quotient_mask <= 0;
+			// Fragments of the last triangle still use its settings.
+			if (fire && !pixels_in_flight) begin
+				color <= color ^ 'hAAA;
+
+				a <= a_in;
+				b <= b_in;
+				c <= c_in;
+				matrix <= matrix_in;
+				format <= format_in;
+				palette <= palette_in;
+				shading <= shading_in;
+				flat <= flat_in;
+				next_quotient_mask <= 0;
 
-			state <= S_XFORM_A_W;
+				state <= S_XFORM_A_W;
+
+			end
 
 		end
 
@@ -1081,7 +1385,11 @@ module Video_Rasterizer #(
 
 		end
 
-		S_RASTERIZING: begin
+		S_RASTERIZING: if (hold) begin
+			// Let the CPU in by inserting bubbles.
+			is_inside <= 0;
+
+		end else begin
 			is_inside <= !(k_0[15] || k_1[15] || k_2[15]);
 
 			raster_x <= x;
@@ -1141,6 +1449,22 @@ module Video_Rasterizer #(
 		texture_x,
 		texture_y;
 
+	bit[15:0]
+		fetch_x,
+		fetch_y;
+
+	bit[15:0]
+		shade_x,
+		shade_y;
+
+	// Position of the texel inside its atlas word.
+	bit[1:0]
+		texture_slot,
+		fetch_slot;
+
+	bit shade;
+	RGB_666 shade_color;
+
 	always @(posedge clock) begin
 		paint_x <= raster_x;
 		paint_y <= raster_y;
@@ -1149,33 +1473,164 @@ module Video_Rasterizer #(
 
 	end
 
-	wire[-1:-16]	
-		alpha =  product_1[47:32],
-		beta  =  product_2[47:32],
-		gamma = -product_1[47:32] - product_2[47:32];
+	wire[-1:-16]
+		alpha = product_1[47:32],
+		beta  = product_2[47:32];
+
+	//
+	// Attributes are interpolated as c + alpha (a - c) + beta (b - c), which
+	// weights c by 1 - alpha - beta without having to fit 1.0 in a 0.16
+	// fraction.
+	//
+	// Textured triangles interpolate `u` and `v` in the first two channels,
+	// and untextured ones red and green through the same multipliers. Only
+	// blue needs a pair of its own.
+	//
 
-	wire[7:-24]
-		raw_u = alpha * a.tex.x[7:-8] + beta * b.tex.x[7:-8] + gamma * c.tex.x[7:-8],
-		raw_v = alpha * a.tex.y[7:-8] + beta * b.tex.y[7:-8] + gamma * c.tex.y[7:-8];
+	wire[31:0]
+		a_rgb = a.tex.x,
+		b_rgb = b.tex.x,
+		c_rgb = c.tex.x;
+
+	wire RGB_666
+		a_color = `rgb666_pack(a_rgb),
+		b_color = `rgb666_pack(b_rgb),
+		c_color = `rgb666_pack(c_rgb);
+
+	wire[15:0]
+		a_1 = textured ? a.tex.x[7:-8] : a_color.r,
+		b_1 = textured ? b.tex.x[7:-8] : b_color.r,
+		c_1 = textured ? c.tex.x[7:-8] : c_color.r,
+
+		a_2 = textured ? a.tex.y[7:-8] : a_color.g,
+		b_2 = textured ? b.tex.y[7:-8] : b_color.g,
+		c_2 = textured ? c.tex.y[7:-8] : c_color.g,
+
+		a_3 = a_color.b,
+		b_3 = b_color.b,
+		c_3 = c_color.b;
+
+	wire signed[16:0]
+		alpha_s = { 1'b0, alpha },
+		beta_s  = { 1'b0, beta },
+
+		a_c_1 = a_1 - c_1,
+		b_c_1 = b_1 - c_1,
+		a_c_2 = a_2 - c_2,
+		b_c_2 = b_2 - c_2,
+		a_c_3 = a_3 - c_3,
+		b_c_3 = b_3 - c_3;
+
+	// Coordinates come out as 8.24, and colors as 6.16.
+	wire signed[33:0]
+		raw_1 = $signed({ 1'b0, c_1, 16'b0 }) + alpha_s * a_c_1 + beta_s * b_c_1,
+		raw_2 = $signed({ 1'b0, c_2, 16'b0 }) + alpha_s * a_c_2 + beta_s * b_c_2,
+		raw_3 = $signed({ 1'b0, c_3, 16'b0 }) + alpha_s * a_c_3 + beta_s * b_c_3;
+
+	wire[7:0]
+		u = raw_1[31:24],
+		v = raw_2[31:24];
+
+	//
+	// Indexed formats pack several texels into every atlas word, so their
+	// rows are twice as long for the 8-bit coordinates to reach all of them.
+	// 4-bit texels go into bits 3:0, 7:4, 11:8 and 15:12 of each word, and
+	// 8-bit texels into bits 7:0 and 15:8.
+	//
+	// That makes room for 256x256 texels in 4 bits, or 256x128 in 8 bits with
+	// `v` wrapping around at 128, where RGB 6:6:6 only fits 128x128. Going
+	// past 4 texels per word would take narrower indices, as the words are
+	// only 18 bits wide.
+	//
+	// Indices are offset by the palette base before looking the color up in
+	// the atlas palette, which happens in parallel with the fetch of the next
+	// texel and only adds latency.
+	//
+
+	wire[A_ADDR_BITS+1:0] texel_index =
+		format[1] ?    2*ATLAS_W * v + u   :
+		/* else ? */     ATLAS_W * v + u;
+
+	wire RGB_444 texel_444 = texel_in[11:0];
 
 	wire[7:0]
-		u = raw_u[7:0],
-		v = raw_v[7:0];
+		texel_indexed4 = texel_in[4*fetch_slot +: 4],
+		texel_indexed8 = texel_in[8*fetch_slot[0] +: 8];
+
+	assign swatch_addr = palette + (
+		format == TEXEL_INDEXED4 ?   texel_indexed4   :
+		/* else ? */                 texel_indexed8);
 
 	always @(posedge clock) begin
-		texel_addr <= ATLAS_W * v + u;
+		texel_addr <=
+			format == TEXEL_INDEXED4 ?   texel_index >> 2   :
+			format == TEXEL_INDEXED8 ?   texel_index >> 1   :
+			/* else ? */                 texel_index;
+
+		texture_slot <= texel_index;
 		texture_x <= paint_x;
 		texture_y <= paint_y;
 
-		texel_strobe <= paint;
+		texel_strobe <= paint && textured;
+
+	end
+
+	always @(posedge clock) begin
+		fetch_slot <= texture_slot;
+		fetch_x <= texture_x;
+		fetch_y <= texture_y;
 
 	end
 
 	always @(posedge clock) begin
-		pixel_addr <= FRAME_W/SCALE * texture_y + texture_x;
-		pixel_out <= texel_in;
+		shade_color <=
+			format == TEXEL_RGB444 ?   `rgb444_to_666(texel_444)   :
+			/* else ? */               texel_in;
+
+		shade_x <= fetch_x;
+		shade_y <= fetch_y;
+
+		shade <= texel_ack;
+
+	end
+
+	//
+	// Untextured fragments skip the atlas altogether and are written as soon
+	// as their barycentric weights are known. In Gouraud mode, the `u`
+	// coordinate of every vertex carries its color in the same layout as the
+	// CPU writes pixels.
+	//
+	// Each triangle runs through one path only, and the next one cannot be
+	// fired until all its fragments are written, so they never collide.
+	//
+
+	wire textured = shading == SHADE_TEXTURED;
+
+	wire RGB_666 plain_color =
+		shading == SHADE_FLAT ?   flat                                          :
+		/* else ? */              { raw_1[21:16], raw_2[21:16], raw_3[21:16] };
+
+	wire RGB_666 color_out =
+		!textured ?    plain_color   :
+		format[1] ?    swatch_in     :
+		/* else ? */   shade_color;
+
+	wire[15:0]
+		out_x = textured ? shade_x : paint_x,
+		out_y = textured ? shade_y : paint_y;
+
+	// Colors are converted to the framebuffer format right before writing.
+	// Indexed framebuffers get RGB 3:3:2 indices.
+	wire[F_WORD_BITS-1:0] out_pixel =
+		PIXEL == "INDEXED" ?   `rgb666_to_332(color_out)   :
+		PIXEL == "RGB444" ?    `rgb666_to_444(color_out)   :
+		/* else ? */           color_out;
+
+	always @(posedge clock) begin
+		pixel_addr <= FRAME_W/SCALE * out_y + out_x;
+		pixel_out <= out_pixel;
 
-		pixel_strobe <= texel_ack;
+		pixel_strobe <= textured ? shade : paint;
 
 	end
 
@@ -6,8 +6,13 @@ build/test/%.vvp: test/%.sv
 	iverilog \
 		-g 2012 \
 		-I rtl \
+		-D 'ATLAS="${ATLAS}"' \
 		-D 'DUMP="build/$*.vcd"' \
 		-D 'FCLK=${FCLK}' \
 		-D 'BAUDS=${BAUDS}' \
+		-D 'PIXEL="${strip ${PIXEL}}"' \
+		-D 'SCALE=${SCALE}' \
+		${if ${SWATCH},-D 'SWATCH="${SWATCH}"'} \
+		-D 'XFIX=${strip ${XFIX}}' \
 		-o "$@" \
 		"$<"
@@ -108,6 +108,28 @@ cmd_video_hello(void)
 	});
 }
 
+void
+cmd_video_shades(void)
+{
+	use_shading(SHADE_GOURAUD, 0);
+
+	raster_triangle((Triangle) {
+		{ { FIX( -1), FIX( -1), FIX(2) }, { 0x3F0000, 0 } },
+		{ { FIX(  1), FIX( -1), FIX(4) }, { 0x003F00, 0 } },
+		{ { FIX( -1), FIX(  1), FIX(2) }, { 0x00003F, 0 } },
+	});
+
+	use_shading(SHADE_FLAT, 0x3F3F3F);
+
+	raster_triangle((Triangle) {
+		{ { FIX(  1), FIX(  1), FIX(4) }, { 0, 0 } },
+		{ { FIX( -1), FIX(  1), FIX(2) }, { 0, 0 } },
+		{ { FIX(  1), FIX( -1), FIX(4) }, { 0, 0 } },
+	});
+
+	use_shading(SHADE_TEXTURED, 0);
+}
+
 static const Triangle model[] = {
 	{
 		{ { FIX(-50), FIX( 10), FIX(10) }, { FIX(  0), FIX(  0) } },
@@ -146,9 +168,13 @@ cmd_video_demo(void)
 		if (ICELINK->full)
 			aim = ICELINK->data;
 
+		if (aim == 'q')
+			return;
+
 		if (!OUIJA->v_blank)
 			continue;
 
+		TRACE_BEGIN(TRACE_FRAME);
 		then = now;
 		// fill_screen(0U);
 
@@ -186,9 +212,37 @@ cmd_video_demo(void)
 		}
 
 		render_model(model, NELEMS(model), pov);
+		TRACE_END(TRACE_FRAME);
 	}
 }
 
+void
+cmd_video_transform(void)
+{
+	const Mat4 m = {
+		{ FIX(FRAME_H), FIX(0), FIX(0), FIX(1.5) },
+		{ FIX(0), FIX(FRAME_H), FIX(0), FIX(-2.5) },
+		{ FIX(0), FIX(0), FIX(0), FIX(0) },
+		{ FIX(0), FIX(0), FIX(1), FIX(1) },
+	};
+
+	fix checksum = 0;
+	const unsigned then = read_cycle();
+
+	for (unsigned pos = 0; pos < NELEMS(model); pos++) {
+		const Vertex *const vertices = &model[pos].a;
+
+		for (int idx = 0; idx < 3; idx++) {
+			const Vec3 xyz = vertices[idx].xyz;
+			const Vec4 out = transform(&m, (Vec4) { xyz.x, xyz.y, xyz.z, FIX(1) });
+			checksum ^= out.x ^ out.y ^ out.z ^ out.w;
+		}
+	}
+
+	const unsigned cycles = read_cycle() - then;
+	print(ICELINK, "%d cycles/vertex (checksum 0x%x)\r\n", cycles / (3 * NELEMS(model)), checksum);
+}
+
 void
 cmd_plot(void)
 {
@@ -220,6 +274,352 @@ cmd_plot(void)
 	put_string(ICELINK, "\x1B\\");
 }
 
+void
+cmd_prof_start(void)
+{
+	// Prime, so that it does not resonate with loops.
+	PROFILER->dropped = 0;
+	PROFILER->period = 10007;
+}
+
+void
+cmd_prof_dump(void)
+{
+	PROFILER->period = 0;
+	print(ICELINK, "profile %d\r\n", PROFILER->count);
+
+	while (PROFILER->count)
+		print(ICELINK, "%x\r\n", PROFILER->sample);
+
+	print(ICELINK, "dropped %d\r\n", PROFILER->dropped);
+}
+
+void
+cmd_trace_dump(void)
+{
+	static const char *const NAMES[] = {
+		[TRACE_FRAME]       = "frame",
+		[TRACE_RENDER]      = "render",
+		[TRACE_RASTER_WAIT] = "raster_wait",
+	};
+
+	const unsigned head = trace_head;
+	const unsigned tail = head > TRACE_DEPTH ? head - TRACE_DEPTH : 0;
+	const unsigned origin = trace_ring[tail % TRACE_DEPTH].cycle;
+
+	// Chrome trace event format, with timestamps in microseconds at 103 MHz.
+	put_string(ICELINK, "[\r\n");
+
+	for (unsigned pos = tail; pos < head; pos++) {
+		const TraceEvent event = trace_ring[pos % TRACE_DEPTH];
+		const unsigned id = event.id & ~TRACE_END_BIT;
+		const unsigned cycles = event.cycle - origin;
+
+		print(ICELINK,
+			"{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%d,\"pid\":0,\"tid\":0,"
+			"\"args\":{\"cycles\":%d,\"instret\":%d}}%s\r\n",
+			id < NELEMS(NAMES) ? NAMES[id] : "?",
+			event.id & TRACE_END_BIT ? 'E' : 'B',
+			cycles / 103U,
+			cycles,
+			event.instret,
+			pos+1 < head ? "," : "");
+	}
+
+	put_string(ICELINK, "]\r\n");
+	trace_head = 0;
+}
+
+// Reads words in hex as written by `od`, up to `len` of them, until EOT.
+static unsigned
+load_words(volatile unsigned to[], const unsigned len)
+{
+	unsigned pos = 0;
+	unsigned word = 0;
+	int digits = 0;
+
+	for (;;) {
+		const char chr = get_char(ICELINK);
+		unsigned digit;
+
+		if (chr >= '0' && chr <= '9')
+			digit = chr - '0';
+		else if (chr >= 'a' && chr <= 'f')
+			digit = chr - 'a' + 10;
+		else if (chr >= 'A' && chr <= 'F')
+			digit = chr - 'A' + 10;
+		else {
+			if (digits && pos < len)
+				to[pos++] = word;
+
+			if (chr == '\4')
+				break;
+
+			word = 0;
+			digits = 0;
+			continue;
+		}
+
+		word = word << 4 | digit;
+		digits++;
+	}
+
+	return pos;
+}
+
+void
+cmd_sdram_load(void)
+{
+	// Terminated by EOT:
+	//
+	//     (cat build/firmware.sdram.hex; printf '\4') > /dev/ttyACM0
+	//
+	print(ICELINK, "%d words\r\n", load_words(SDRAM, ~0U));
+	flush_instructions();
+}
+
+//
+// SDRAM self-test. The scratch area starts 1 MiB in, past the image
+// `sdram/load` writes but still within what `test/sdram_model.sv` stores.
+// It is twice as large as the data cache, so that lines are evicted before
+// being read back.
+//
+
+#define SCRATCH         (SDRAM + 0x40000U)
+#define SCRATCH_WORDS   512U
+
+typedef unsigned Probe(void);
+
+// Part of the image, to tell whether it was loaded.
+static const unsigned canary IN_SDRAM = 0xC0FFEE;
+
+static int
+sdram_loaded(void)
+{
+	return *(volatile const unsigned *)&canary == 0xC0FFEE;
+}
+
+// Writes a function returning `val` and calls it, which goes through the
+// instruction cache.
+static unsigned
+run_probe(const unsigned val)
+{
+	SCRATCH[0] = val << 20 | 0x513;   // addi a0, zero, val
+	SCRATCH[1] = 0x8067;              // ret
+	flush_instructions();
+
+	return ((Probe *)(uint)SCRATCH)();
+}
+
+static void
+cmd_sdram_test(void)
+{
+	const int loaded = sdram_loaded();
+	unsigned state = 1;
+	unsigned errors = 0;
+
+	for (unsigned pos = 0; pos < SCRATCH_WORDS; pos++)
+		SCRATCH[pos] = state = next_xorshift(state);
+
+	state = 1;
+
+	for (unsigned pos = 0; pos < SCRATCH_WORDS; pos++)
+		if (SCRATCH[pos] != (state = next_xorshift(state)))
+			errors++;
+
+	// A stale instruction cache would keep returning the first value.
+	const int fresh = run_probe(1) == 1 && run_probe(2) == 2;
+
+	print(
+		ICELINK,
+		"image %s, %d/%d words wrong, code %s\r\n",
+		loaded ? "loaded" : "missing",
+		errors,
+		SCRATCH_WORDS,
+		fresh ? "fresh" : "stale");
+}
+
+// The whole mesh does not fit in RAM, so it only comes with the SDRAM image.
+static const Triangle dingus[] IN_SDRAM = {
+#include "dingus_nowhiskers.h"
+};
+
+static void
+cmd_video_dingus(void)
+{
+	if (!sdram_loaded()) {
+		print(ICELINK, "SDRAM image missing, see sdram/load\r\n");
+		return;
+	}
+
+	// Its y goes up and it stands around the origin, so it is flipped and
+	// seen from 30 units away, centered on its middle.
+	OUIJA->matrix.i = (Vec4) { FIX(FRAME_H), FIX(0), FIX(0), FIX(0) };
+	OUIJA->matrix.j = (Vec4) { FIX(0), FIX(-FRAME_H), FIX(0), FIX(9 * FRAME_H) };
+	OUIJA->matrix.k = (Vec4) { FIX(0), FIX(0), FIX(0), FIX(0) };
+	OUIJA->matrix.l = (Vec4) { FIX(0), FIX(0), FIX(1), FIX(30) };
+
+	fill_screen(0);
+	const unsigned drawn = OUIJA->drawn;
+	const unsigned then = read_cycle();
+
+	for (unsigned pos = 0; pos < NELEMS(dingus); pos++)
+		fire_triangle(dingus[pos]);
+
+	while (OUIJA->busy) {}
+
+	const unsigned cycles = read_cycle() - then;
+
+	print(
+		ICELINK,
+		"%d/%d triangles drawn in %d cycles\r\n",
+		OUIJA->drawn - drawn,
+		NELEMS(dingus),
+		cycles);
+}
+
+//
+// Camera-path replay. Every run renders the same frames, so their times can
+// be compared across firmware and bitstream changes.
+//
+
+#define PATH_LEN        32U
+#define REPLAY_FRAMES   1024U
+#define BUCKETS         16U
+
+// The camera glides from each keyframe to the next in `frames` frames.
+typedef struct {
+	Vec3 pov;
+	unsigned frames;
+} Keyframe;
+
+static Keyframe path[PATH_LEN] = {
+	{ { FIX(-40 * FRAME_H), FIX( 0 * FRAME_H), FIX(0) }, 120 },
+	{ { FIX(-30 * FRAME_H), FIX( 5 * FRAME_H), FIX(0) }, 120 },
+	{ { FIX(-50 * FRAME_H), FIX(-5 * FRAME_H), FIX(0) }, 240 },
+	{ { FIX(-40 * FRAME_H), FIX( 0 * FRAME_H), FIX(0) },   0 },
+};
+
+static unsigned path_len = 4;
+static unsigned frame_cycles[REPLAY_FRAMES];
+
+// Waits for the start of the next vertical blank, not just any point in it.
+static void
+wait_v_blank(void)
+{
+	while (OUIJA->v_blank) {}
+	while (!OUIJA->v_blank) {}
+}
+
+// `frame` frames into a glide of `frames`, without the error of a rounded
+// step piling up.
+static fix
+glide(const fix from, const fix to, const int frame, const int frames)
+{
+	const fix delta = to - from;
+	return from + frame * (delta / frames) + frame * (delta % frames) / frames;
+}
+
+static void
+sort(unsigned vals[], const unsigned len)
+{
+	for (unsigned pos = 1; pos < len; pos++) {
+		const unsigned val = vals[pos];
+		unsigned hole = pos;
+
+		for (; hole && vals[hole - 1] > val; hole--)
+			vals[hole] = vals[hole - 1];
+
+		vals[hole] = val;
+	}
+}
+
+void
+cmd_video_path(void)
+{
+	// Keyframes as { x, y, z, frames } words, terminated by EOT.
+	const unsigned len = load_words((unsigned *)path, 4 * NELEMS(path));
+
+	path_len = len / 4;
+	print(ICELINK, "%d keyframes\r\n", path_len);
+}
+
+void
+cmd_video_replay(void)
+{
+	static unsigned histogram[BUCKETS];
+
+	unsigned len = 0;
+	unsigned submitted = 0;
+	unsigned drawn = 0;
+	unsigned misses = 0;
+
+	set_memory(histogram, 0, sizeof(histogram));
+
+	wait_v_blank();
+	const unsigned then = read_cycle();
+	wait_v_blank();
+	const unsigned period = read_cycle() - then;
+
+	for (unsigned key = 0; key + 1 < path_len; key++) {
+		const Keyframe from = path[key];
+		const Keyframe to = path[key + 1];
+		const int frames = MAX(from.frames, 1U);
+
+		for (unsigned frame = 0; frame < from.frames && len < REPLAY_FRAMES; frame++) {
+			const Vec3 pov = {
+				glide(from.pov.x, to.pov.x, frame, frames),
+				glide(from.pov.y, to.pov.y, frame, frames),
+				glide(from.pov.z, to.pov.z, frame, frames),
+			};
+
+			// Frames start with the blank, and miss it if they take longer.
+			wait_v_blank();
+			TRACE_BEGIN(TRACE_FRAME);
+			const unsigned start = read_cycle();
+
+			drawn += render_model(model, NELEMS(model), pov);
+			submitted += NELEMS(model);
+
+			const unsigned cycles = read_cycle() - start;
+			TRACE_END(TRACE_FRAME);
+
+			frame_cycles[len++] = cycles;
+			misses += cycles / period;
+			histogram[MIN(cycles / (period / 4), BUCKETS - 1)]++;
+		}
+	}
+
+	if (!len)
+		return;
+
+	sort(frame_cycles, len);
+
+	print(
+		ICELINK,
+		"%d frames, %d triangles submitted, %d drawn, %d v-blank misses\r\n",
+		len,
+		submitted,
+		drawn,
+		misses);
+
+	print(
+		ICELINK,
+		"min %d, median %d, p99 %d cycles, %d per refresh\r\n",
+		frame_cycles[0],
+		frame_cycles[len / 2],
+		frame_cycles[(99*len + 99) / 100 - 1],
+		period);
+
+	// Frame times in quarters of a refresh.
+	for (unsigned bucket = 0; bucket < BUCKETS - 1; bucket++)
+		if (histogram[bucket])
+			print(ICELINK, "%d-%d/4: %d\r\n", bucket, bucket + 1, histogram[bucket]);
+
+	if (histogram[BUCKETS - 1])
+		print(ICELINK, "%d/4+: %d\r\n", BUCKETS - 1, histogram[BUCKETS - 1]);
+}
+
 void
 cmd_random(void)
 {
@@ -230,17 +630,27 @@ static const struct {
 	const char *name;
 	Command *proc;
 } COMMANDS[] = {
-	{ "wait/1s",     cmd_wait_1s },
-	{ "wait/10s",    cmd_wait_10s },
-	{ "csr/cycle",   cmd_csr_cycle },
-	{ "csr/time",    cmd_csr_time },
-	{ "csr/instret", cmd_csr_instret },
-	{ "video/clear", cmd_video_clear },
-	{ "video/fill",  cmd_video_fill },
-	{ "video/hello", cmd_video_hello },
-	{ "video/demo",  cmd_video_demo },
-	{ "plot",        cmd_plot },
-	{ "random",      cmd_random },
+	{ "wait/1s",          cmd_wait_1s },
+	{ "wait/10s",         cmd_wait_10s },
+	{ "csr/cycle",        cmd_csr_cycle },
+	{ "csr/time",         cmd_csr_time },
+	{ "csr/instret",      cmd_csr_instret },
+	{ "video/clear",      cmd_video_clear },
+	{ "video/fill",       cmd_video_fill },
+	{ "video/hello",      cmd_video_hello },
+	{ "video/shades",     cmd_video_shades },
+	{ "video/demo",       cmd_video_demo },
+	{ "video/dingus",     cmd_video_dingus },
+	{ "video/path",       cmd_video_path },
+	{ "video/replay",     cmd_video_replay },
+	{ "video/transform",  cmd_video_transform },
+	{ "plot",             cmd_plot },
+	{ "prof/start",       cmd_prof_start },
+	{ "prof/dump",        cmd_prof_dump },
+	{ "trace/dump",       cmd_trace_dump },
+	{ "sdram/load",       cmd_sdram_load },
+	{ "sdram/test",       cmd_sdram_test },
+	{ "random",           cmd_random },
 };
 
 Command *
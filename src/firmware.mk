@@ -10,8 +10,14 @@ build/firmware.elf: \
 
 build/src/*.o: ${LDSCRIPT}
 
+build/src/command.o: build/res/dingus_nowhiskers.h
+
 build/%.hex: build/%.elf
-	riscv64-unknown-elf-objcopy -O binary "$<" /dev/stdout \
+	riscv64-unknown-elf-objcopy -O binary -R .sdram "$<" /dev/stdout \
+	| od -v -A n -t x4 > "$@"
+
+build/%.sdram.hex: build/%.elf
+	riscv64-unknown-elf-objcopy -O binary -j .sdram "$<" /dev/stdout \
 	| od -v -A n -t x4 > "$@"
 
 build/%.elf:
@@ -31,7 +37,12 @@ build/src/%.o: src/%.[cS]
 	@mkdir -p `dirname "$@"`
 	riscv64-unknown-elf-gcc \
 		-c \
+		-DATLAS_${strip ${TEXEL}} \
 		-DBAUDS=${BAUDS} \
+		-DPIXEL_${strip ${PIXEL}} \
+		-DSCALE=${SCALE} \
+		-DXFIX=${strip ${XFIX}} \
+		-I build/res \
 		-fno-builtin \
 		-mabi=ilp32 \
 		-march=${ISA} \
@@ -1,17 +1,60 @@
 #include "u.h"
 #include "graphics.h"
 
-inline fix
-fix_mul(const fix l, const fix r)
+fix
+fix_dot(const Vec4 l, const Vec4 r)
 {
-	vlong product = (vlong)l * (int)r;
-	return (product + 0x8000) >> 16;
+	// Rounded once, at the end.
+	fix_mul_load(l.x, r.x);
+	fix_mac(l.y, r.y);
+	fix_mac(l.z, r.z);
+	return fix_mac(l.w, r.w);
+}
+
+Vec4
+transform(const Mat4 *const m, const Vec4 v)
+{
+	return (Vec4) {
+		fix_dot(m->i, v),
+		fix_dot(m->j, v),
+		fix_dot(m->k, v),
+		fix_dot(m->l, v),
+	};
+}
+
+void
+init_video(void)
+{
+#ifdef PIXEL_INDEXED
+	// Identity RGB 3:3:2 palette, matching what the rasterizer writes.
+	for (unsigned idx = 0; idx < 256; idx++) {
+		const unsigned r = idx >> 5;
+		const unsigned g = idx >> 2 & 07;
+		const unsigned b = idx & 03;
+
+		PALETTE[idx] =
+			  (r << 3 | r) << 16
+			| (g << 3 | g) << 8
+			| (b << 4 | b << 2 | b);
+	}
+#endif
+
+	// The atlas comes preloaded in the format picked when building.
+#if defined(ATLAS_RGB444)
+	use_texels(TEXEL_RGB444, 0);
+#elif defined(ATLAS_INDEXED8)
+	use_texels(TEXEL_INDEXED8, 0);
+#elif defined(ATLAS_INDEXED4)
+	use_texels(TEXEL_INDEXED4, 0);
+#else
+	use_texels(TEXEL_RGB666, 0);
+#endif
 }
 
 void
 fill_screen(const Color color)
 {
-	for (int pos = 0; pos < 320*200; pos += 8) {
+	for (int pos = 0; pos < FRAME_W*FRAME_H; pos += 8) {
 		FRAME[pos + 0] = color;
 		FRAME[pos + 1] = color;
 		FRAME[pos + 2] = color;
@@ -23,6 +66,22 @@ fill_screen(const Color color)
 	}
 }
 
+void
+use_texels(const TexelFormat format, const unsigned palette_base)
+{
+	// Latched by the rasterizer when firing, so no need to wait.
+	OUIJA->texel_format = format;
+	OUIJA->palette_base = palette_base;
+}
+
+void
+use_shading(const Shading shading, const unsigned color)
+{
+	// In Gouraud mode, vertex colors go in place of their `u` coordinate.
+	OUIJA->shading = shading;
+	OUIJA->color = color;
+}
+
 inline int
 is_top_left(Vec2 start, Vec2 end) {
 	Vec2 edge = { end.x - start.x, end.y - start.y };
@@ -32,7 +91,7 @@ is_top_left(Vec2 start, Vec2 end) {
 	return is_left_edge || is_top_edge;
 }
 
-inline int
+static inline int
 edge_cross(Vec2 a, Vec2 b, Vec2 p) {
 	Vec2 ab = { b.x - a.x, b.y - a.y };
 	Vec2 ap = { p.x - a.x, p.y - a.y };
@@ -40,9 +99,12 @@ edge_cross(Vec2 a, Vec2 b, Vec2 p) {
 	return fix_mul(ab.x, ap.y) - fix_mul(ab.y, ap.x);
 }
 
-void
+int
 render_model(const Triangle model[], const int len, const Vec3 pov)
 {
+	TRACE_BEGIN(TRACE_RENDER);
+	const unsigned drawn = OUIJA->drawn;
+
 	for (int pos = 0; pos < len; pos++) {
 		Triangle tri = model[pos];
 		// Tri2 tri_2;
@@ -73,13 +135,20 @@ render_model(const Triangle model[], const int len, const Vec3 pov)
 
 		// tri_2.c.xy.x = FIX(160) + fix_mul(fix_mul(fov, c_x), c_z_inv);
 		// tri_2.c.xy.y = FIX(100) - fix_mul(fix_mul(fov, c_y), c_z_inv);
-		OUIJA->matrix.i = (Vec4) { FIX(100.0), FIX(  0.0), FIX(  0.0),   -pov.x };
-		OUIJA->matrix.j = (Vec4) { FIX(  0.0), FIX(100.0), FIX(  0.0),   -pov.y };
+		OUIJA->matrix.i = (Vec4) { FIX(FRAME_H), FIX(    0), FIX(  0.0),   -pov.x };
+		OUIJA->matrix.j = (Vec4) { FIX(    0), FIX(FRAME_H), FIX(  0.0),   -pov.y };
 		OUIJA->matrix.k = (Vec4) { FIX(  0.0), FIX(  0.0), FIX(  0.0),   -pov.z };
 		OUIJA->matrix.l = (Vec4) { FIX(  0.0), FIX(  0.0), FIX(  1.0), FIX(1.0) };
 
-		raster_triangle(tri);
+		fire_triangle(tri);
 	}
+
+	// Back faces are culled by the rasterizer, wait until it is done with
+	// the last one to count them.
+	while (OUIJA->busy) {}
+
+	TRACE_END(TRACE_RENDER);
+	return OUIJA->drawn - drawn;
 }
 
 fix
@@ -167,14 +236,12 @@ raster_triangle(const Triangle tri)
 	// OUIJA->matrix.j = (Vec4) { FIX(  0.0), FIX(100.0), FIX(  0.0), FIX(   50.0) };
 	// OUIJA->matrix.k = (Vec4) { FIX(  0.0), FIX(  0.0),    0x10008, FIX(-4096.5) };
 	// OUIJA->matrix.l = (Vec4) { FIX(  0.0), FIX(  0.0), FIX(  1.0), FIX(    0.0) };
-	OUIJA->matrix.i = (Vec4) { FIX(100.0), FIX(  0.0), FIX(  0.0), FIX(    0.0) };
-	OUIJA->matrix.j = (Vec4) { FIX(  0.0), FIX(100.0), FIX(  0.0), FIX(    0.0) };
+	OUIJA->matrix.i = (Vec4) { FIX(FRAME_H), FIX(    0), FIX(  0.0), FIX(    0.0) };
+	OUIJA->matrix.j = (Vec4) { FIX(    0), FIX(FRAME_H), FIX(  0.0), FIX(    0.0) };
 	OUIJA->matrix.k = (Vec4) { FIX(  0.0), FIX(  0.0), FIX(  0.0), FIX(    0.0) };
 	OUIJA->matrix.l = (Vec4) { FIX(  0.0), FIX(  0.0), FIX(  1.0), FIX(    0.0) };
-	OUIJA->triangle = tri;
 
-	while (OUIJA->busy) {}
-	OUIJA->fire = 1;
+	fire_triangle(tri);
 
 				// int alpha = (unsigned long long)(256*w0)*area_recip >> 32U;
 				// int beta  = (unsigned long long)(256*w1)*area_recip >> 32U;
@@ -200,3 +267,16 @@ raster_triangle(const Triangle tri)
 				// 	b = srgb2linear[sb];
 				// }
 }
+
+void
+fire_triangle(const Triangle tri)
+{
+	// Uses whatever matrix is already loaded.
+	OUIJA->triangle = tri;
+
+	TRACE_BEGIN(TRACE_RASTER_WAIT);
+	while (OUIJA->busy) {}
+	TRACE_END(TRACE_RASTER_WAIT);
+
+	OUIJA->fire = 1;
+}
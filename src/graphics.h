@@ -1,5 +1,21 @@
+#define FRAME_W   (640 / SCALE)
+#define FRAME_H   (400 / SCALE)
+
 typedef unsigned short Color;
 
+typedef enum {
+	TEXEL_RGB666,
+	TEXEL_RGB444,
+	TEXEL_INDEXED8,
+	TEXEL_INDEXED4,
+} TexelFormat;
+
+typedef enum {
+	SHADE_TEXTURED,
+	SHADE_FLAT,
+	SHADE_GOURAUD,
+} Shading;
+
 typedef struct {
 	fix x;
 	fix y;
@@ -42,8 +58,20 @@ typedef struct {
 	unsigned fire;
 	unsigned busy;
 	Triangle triangle;
+	unsigned texel_format;
+	unsigned palette_base;
+	unsigned shading;
+	unsigned color;
+	unsigned drawn;
 } Ouija;
 
-void render_model(const Triangle model[], const int len, const Vec3 pov);
+fix fix_dot(const Vec4 l, const Vec4 r);
+Vec4 transform(const Mat4 *const m, const Vec4 v);
+
+void init_video(void);
+int render_model(const Triangle model[], const int len, const Vec3 pov);
 void fill_screen(const Color color);
+void use_texels(const TexelFormat format, const unsigned palette_base);
+void use_shading(const Shading shading, const unsigned color);
 void raster_triangle(const Triangle tri);
+void fire_triangle(const Triangle tri);
@@ -1,5 +1,6 @@
 #include "u.h"
 #include "command.h"
+#include "graphics.h"
 
 const char BANNER[] =
 	"\r\n"
@@ -67,6 +68,7 @@ main(void)
 	static char new_line[256U];
 	static char line[256U];
 
+	init_video();
 	lookup_command("video/hello")();
 	put_string(ICELINK, BANNER);
 
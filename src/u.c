@@ -62,24 +62,17 @@ put_char(Uart *const uart, const char chr)
 void
 put_decimal(Uart *const uart, unsigned val, int len)
 {
-	len = MAX(len, 1 +
-		(val >         9) +
-		(val >        99) +
-		(val >       999) +
-		(val >      9999) +
-		(val >     99999) +
-		(val >    999999) +
-		(val >   9999999) +
-		(val >  99999999) +
-		(val > 999999999));
-
-	int pos = len-1;
-
-	unsigned powers[] = {
+	static const unsigned powers[] = {
 		1, 10, 100, 1000, 10000, 100000,
 		1000000, 10000000, 100000000, 1000000000
 	};
 
+	// 1233/4096 approximates log10(2), which may overshoot by one digit.
+	const int guess = BITS(val) * 1233 >> 12;
+	len = MAX(len, 1 + guess - ((val | 1) < powers[guess]));
+
+	int pos = len-1;
+
 	// Pad zeros beyond the integer length limit.
 	for (; pos > 9; --pos)
 		put_char(uart, '0');
@@ -99,14 +92,7 @@ put_decimal(Uart *const uart, unsigned val, int len)
 void
 put_hexadecimal(Uart *const uart, const unsigned val, int len)
 {
-	len = MAX(len, 1 +
-		(val >       0xF) +
-		(val >      0xFF) +
-		(val >     0xFFF) +
-		(val >    0xFFFF) +
-		(val >   0xFFFFF) +
-		(val >  0xFFFFFF) +
-		(val > 0xFFFFFFF));
+	len = MAX(len, (BITS(val) + 3) / 4);
 
 	int pos = len-1;
 
@@ -129,17 +115,7 @@ put_hexadecimal(Uart *const uart, const unsigned val, int len)
 void
 put_octal(Uart *const uart, const unsigned val, int len)
 {
-	len = MAX(len, 1 +
-		(val >          07) +
-		(val >         077) +
-		(val >        0777) +
-		(val >       07777) +
-		(val >      077777) +
-		(val >     0777777) +
-		(val >    07777777) +
-		(val >   077777777) +
-		(val >  0777777777) +
-		(val > 07777777777));
+	len = MAX(len, (BITS(val) + 2) / 3);
 
 	int pos = len-1;
 
@@ -1,5 +1,6 @@
 typedef unsigned char uchar;
 typedef unsigned int uint;
+typedef unsigned short ushort;
 typedef unsigned long ulong;
 typedef unsigned long long uvlong;
 
@@ -15,16 +16,37 @@ typedef volatile struct {
 	int full;
 } Uart;
 
+typedef volatile struct {
+	unsigned period;
+	unsigned count;
+	unsigned sample;
+	unsigned dropped;
+} Profiler;
+
 #define NULL                            ((void *)0U)
+#define PROFILER  ((volatile Profiler *)0x10000000U)
+#define SDRAM     ((volatile unsigned *)0x18000000U)
 #define ICELINK       ((volatile Uart *)0x20000000U)
 // Defined in `graphics.h`.
 #define OUIJA        ((volatile Ouija *)0x30000000U)
-#define FRAME     ((volatile unsigned *)0x30020000U)
-#define TEXTURE   ((volatile unsigned *)0x30040000U)
+#define PALETTE   ((volatile unsigned *)0x30000400U)
+#define SWATCHES  ((volatile unsigned *)0x30000800U)
+#define FRAME     ((volatile unsigned *)0x30040000U)
+#define TEXTURE   ((volatile unsigned *)0x30080000U)
+// Same atlas, holding words as they are instead of RGB 6:6:6 colors.
+#define TEXELS    ((volatile unsigned *)0x300C0000U)
+
+// Places big, cold assets in SDRAM. They must be loaded with `sdram/load`.
+#define IN_SDRAM           __attribute__((section(".sdram.rodata")))
 
 #define NELEMS(array)      (sizeof(array) / sizeof(*array))
 #define MIN(left, right)   ((left) < (right) ? (left) : (right))
 #define MAX(left, right)   ((left) > (right) ? (left) : (right))
+#if defined(__riscv) && !defined(__riscv_zbb)
+#define BITS(u)            bit_width(u)
+#else
+#define BITS(u)            (32 - __builtin_clz((u) | 1U))
+#endif
 #define FIX(i)             (fix)((i) * 0x10000)
 #define INT(f)             (fix)((f) / 0x10000)
 #define FRACT(f)           (fix)((f) % 0x10000)
@@ -42,6 +64,15 @@ void *copy_memory(
 
 void *set_memory(void *const mem, char val, unsigned len);
 
+// Makes code written to memory visible to instruction fetches, as the
+// instruction cache does not see data writes. Spelled out as fence.i, so
+// that Zifencei is not needed in `-march`.
+static inline void
+flush_instructions(void)
+{
+	__asm__ volatile (".insn i 0x0F, 1, x0, x0, 0" ::: "memory");
+}
+
 //
 // Console.
 //
@@ -68,6 +99,26 @@ int compare_strings(const char *left, const char *right);
 unsigned xorshift(void);
 unsigned next_xorshift(unsigned state);
 
+#if defined(__riscv) && !defined(__riscv_zbb)
+
+// Without Zbb, `__builtin_clz` becomes a call into libgcc, which is not
+// linked. Binary search instead.
+static inline unsigned
+bit_width(unsigned u)
+{
+	unsigned bits = 1;
+
+	for (unsigned step = 16; step; step /= 2)
+		if (u >> step) {
+			u >>= step;
+			bits += step;
+		}
+
+	return bits;
+}
+
+#endif
+
 //
 // Counters
 //
@@ -76,3 +127,103 @@ extern void spin_cycles(int n);
 extern unsigned long long read_cycle(void);
 extern unsigned long long read_time(void);
 extern unsigned long long read_instret(void);
+
+//
+// Tracing.
+//
+
+#define TRACE_DEPTH       256U
+#define TRACE_BEGIN(id)   trace(id)
+#define TRACE_END(id)     trace((id) | TRACE_END_BIT)
+#define TRACE_END_BIT     0x80000000U
+
+typedef enum {
+	TRACE_FRAME,
+	TRACE_RENDER,
+	TRACE_RASTER_WAIT,
+} TraceId;
+
+typedef struct {
+	unsigned cycle;
+	unsigned instret;
+	unsigned id;
+} TraceEvent;
+
+// Defined in `boot.S`. Only the low halves of the counters are recorded, so
+// traces longer than 2^32 cycles wrap around.
+extern TraceEvent trace_ring[TRACE_DEPTH];
+extern unsigned trace_head;
+extern void trace(unsigned id);
+
+//
+// Fixed-point.
+//
+
+#ifndef XFIX
+#define XFIX 0
+#endif
+
+#if XFIX
+
+// Xfix opcodes live in custom-0 and are told apart by `funct3`.
+#define XFIX_INSN(funct_3)   ".insn r 0x0B, " #funct_3 ", 0, %0, %1, %2"
+
+// Operations on the accumulator are volatile to keep them in order. The
+// product alone is pure.
+
+// Rounded 16.16 product.
+static inline fix
+fix_mul(const fix left, const fix right)
+{
+	fix out;
+	__asm__ (XFIX_INSN(0) : "=r"(out) : "r"(left), "r"(right));
+	return out;
+}
+
+// Same as `fix_mul`, also loading the accumulator with the product.
+static inline fix
+fix_mul_load(const fix left, const fix right)
+{
+	fix out;
+	__asm__ volatile (XFIX_INSN(2) : "=r"(out) : "r"(left), "r"(right));
+	return out;
+}
+
+// Adds the product to the accumulator, and returns it rounded to 16.16.
+static inline fix
+fix_mac(const fix left, const fix right)
+{
+	fix out;
+	__asm__ volatile (XFIX_INSN(1) : "=r"(out) : "r"(left), "r"(right));
+	return out;
+}
+
+#undef XFIX_INSN
+
+#else
+
+// Stands for the accumulator, which is 16.32 and wraps around at 48 bits.
+static uvlong fix_accumulator;
+
+static inline fix
+fix_mul(const fix left, const fix right)
+{
+	const vlong product = (vlong)left * right;
+	return (product + 0x8000) >> 16;
+}
+
+static inline fix
+fix_mul_load(const fix left, const fix right)
+{
+	fix_accumulator = (vlong)left * right;
+	return (uint)((fix_accumulator + 0x8000) >> 16);
+}
+
+static inline fix
+fix_mac(const fix left, const fix right)
+{
+	fix_accumulator += (vlong)left * right;
+	return (uint)((fix_accumulator + 0x8000) >> 16);
+}
+
+#endif
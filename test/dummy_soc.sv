@@ -1,6 +1,7 @@
 `timescale 1ns/100ps
 
 `include "rtl/SoC.sv"
+`include "test/sdram_model.sv"
 
 module Test;
 
@@ -14,29 +15,71 @@ module Test;
 	always #(T_CLOCK/2)
 		board_clock <= !board_clock;
 
+	wire sdram_clock, sdram_cke;
+	wire sdram_cs_, sdram_ras_, sdram_cas_, sdram_we_;
+	wire[1:0] sdram_ba, sdram_dm;
+	wire[12:0] sdram_a;
+	wire[15:0] sdram_dq;
+
 	SoC soc(
 		.board_clock,
-		.icelink_rx
+		.icelink_rx,
+
+		.sdram_clock,
+		.sdram_cke,
+		.sdram_cs_,
+		.sdram_ras_,
+		.sdram_cas_,
+		.sdram_we_,
+		.sdram_ba,
+		.sdram_a,
+		.sdram_dm,
+		.sdram_dq
+	);
+
+	SDRAM_Model #(
+		.FILE("build/firmware.sdram.hex")
+	) sdram(
+		.sdram_clock,
+		.sdram_cke,
+		.sdram_cs_,
+		.sdram_ras_,
+		.sdram_cas_,
+		.sdram_we_,
+		.sdram_ba,
+		.sdram_a,
+		.sdram_dm,
+		.sdram_dq
 	);
 
+	task automatic send(input byte chr);
+		icelink_rx <= 0;
+
+		for (int pos = 0; pos < 8; pos++)
+			#T_BAUD icelink_rx <= chr[pos];
+
+		#T_BAUD icelink_rx <= 1;
+		#T_BAUD;
+	endtask
+
+	task automatic type_line(input string line);
+		for (int pos = 0; pos < line.len(); pos++)
+			send(line[pos]);
+	endtask
+
+	// Runs both caches against the SDRAM model, then draws the mesh that only
+	// lives there. Results are printed on `soc.icelink_tx`.
 	initial begin
 		$dumpfile(`DUMP);
 		$dumpvars;
 
-		#600us icelink_rx <= 0;
-
-		#T_BAUD icelink_rx <= 1;
-		#T_BAUD icelink_rx <= 0;
-		#T_BAUD icelink_rx <= 0;
-		#T_BAUD icelink_rx <= 0;
-		#T_BAUD icelink_rx <= 0;
-		#T_BAUD icelink_rx <= 0;
-		#T_BAUD icelink_rx <= 1;
-		#T_BAUD icelink_rx <= 0;
+		#600us;
+		type_line("sdram/test\r");
 
-		#T_BAUD icelink_rx <= 1;
+		#1ms;
+		type_line("video/dingus\r");
 
-		#600us $finish;
+		#2ms $finish;
 	end
 
 endmodule
\ No newline at end of file
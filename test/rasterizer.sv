@@ -0,0 +1,132 @@
+`timescale 1ns/100ps
+
+`include "rtl/types.svh"
+`include "rtl/BRAM_delayed_ports.sv"
+`include "rtl/Video_reborn.sv"
+
+// Differential test of the rasterizer against `model/ouija.c`.
+//
+// Triangles generated by `build/model/fuzz` are fired one at a time through
+// the MMIO registers. The cycles each one keeps the rasterizer busy and the
+// checksum of its pixel writes must match the model, and so must the whole
+// framebuffer at the end.
+module Test;
+
+	localparam
+		FRAME_W       = 640,
+		FRAME_H       = 400,
+		F_NUM_WORDS   = FRAME_W/`SCALE * FRAME_H/`SCALE,
+		MAX_TRIANGLES = 4096,
+		REG_WORDS     = 39,
+		R_V_BLANK     = 16,
+		R_FIRE        = 17,
+		R_BUSY        = 18,
+		R_DRAWN       = 38,
+		T_CLOCK       = 40ns;
+
+	bit clock = 0;
+
+	always #(T_CLOCK/2)
+		clock <= !clock;
+
+	bit[25:0] addr = 0;
+	bit[31:0] in = 0;
+	bit write = 0;
+	bit strobe = 0;
+
+	Video #(
+		.BYTE_BITS(8),
+		.BYTES_PER_WORD(4),
+
+		.SCALE(`SCALE),
+		.PIXEL(`PIXEL),
+		.ATLAS("build/fuzz/atlas.hex"),
+		.SWATCH("build/fuzz/swatches.hex")
+	) video(
+		.beam_clock(clock),
+
+		.bus_clock(clock),
+		.addr,
+		.in,
+		.write,
+		.select('b1111),
+		.strobe
+	);
+
+	bit[31:0] triangles[MAX_TRIANGLES * REG_WORDS];
+	bit[31:0] expected[MAX_TRIANGLES * 2];
+	bit[31:0] frame[F_NUM_WORDS];
+
+	int len = 256;
+	int errors = 0;
+
+	bit[31:0] hash;
+	bit[31:0] cycles;
+
+	// Same checksum as `OUIJA_HASH`.
+	always @(posedge clock) if (video.pixel_strobe)
+		hash <= hash * 33 ^ (32'(video.pixel_addr) << 18 | 32'(video.pixel));
+
+	task automatic store(input int pos, input bit[31:0] word);
+		@(negedge clock);
+		addr = pos;
+		in = word;
+		write = 1;
+		strobe = 1;
+
+		@(negedge clock);
+		strobe = 0;
+	endtask
+
+	initial begin
+		if (!$value$plusargs("triangles=%d", len))
+			$display("triangles not given, assuming %0d", len);
+
+		$readmemh("build/fuzz/triangles.hex", triangles, 0, len*REG_WORDS - 1);
+		$readmemh("build/fuzz/expected.hex", expected, 0, len*2 - 1);
+		$readmemh("build/fuzz/frame.hex", frame);
+
+		for (int tri = 0; tri < len; tri++) begin
+			// Only inputs, the rest are status or strobes.
+			for (int pos = 0; pos < REG_WORDS; pos++)
+				if (pos != R_V_BLANK && pos != R_FIRE && pos != R_BUSY && pos != R_DRAWN)
+					store(pos, triangles[tri*REG_WORDS + pos]);
+
+			hash = 0;
+			store(R_FIRE, 1);
+
+			// The fire edge is behind, count until the rasterizer is idle.
+			cycles = 0;
+
+			while (video.rasterizing) begin
+				@(negedge clock);
+				cycles++;
+			end
+
+			if (cycles != expected[2*tri] || hash != expected[2*tri + 1]) begin
+				$display(
+					"triangle %0d: %0d cycles, hash %h, expected %0d cycles, hash %h",
+					tri, cycles, hash, expected[2*tri], expected[2*tri + 1]);
+
+				errors++;
+			end
+
+		end
+
+		for (int pos = 0; pos < F_NUM_WORDS; pos++)
+			if (video.frame.data[pos] != frame[pos]) begin
+				$display(
+					"pixel %0d: %h, expected %h",
+					pos, video.frame.data[pos], frame[pos]);
+
+				errors++;
+			end
+
+		if (errors)
+			$fatal(1, "%0d mismatches in %0d triangles", errors, len);
+
+		$display("%0d triangles match the model", len);
+		$finish;
+	end
+
+endmodule
@@ -0,0 +1,156 @@
+// Behavioural model of a 16-bit SDR SDRAM chip, for simulation only.
+//
+// It understands the subset of commands the SDRAM controller issues and
+// complains about accesses that a real chip would get wrong.
+//
+// Only the lowest 2^MEM_BITS halves are stored; higher addresses alias.
+module SDRAM_Model #(
+	parameter
+		BANK_BITS = 2,
+		ROW_BITS  = 13,
+		COL_BITS  = 9,
+		MEM_BITS  = 20,
+
+		// Preloaded 32-bit words, if any.
+		FILE = 'x
+) (
+	input wire                 sdram_clock,
+	input wire                 sdram_cke,
+	input wire                 sdram_cs_,
+	input wire                 sdram_ras_,
+	input wire                 sdram_cas_,
+	input wire                 sdram_we_,
+	input wire[BANK_BITS-1:0]  sdram_ba,
+	input wire[ROW_BITS-1:0]   sdram_a,
+	input wire[1:0]            sdram_dm,
+	inout wire[15:0]           sdram_dq
+);
+
+	localparam
+		C_NOP       = 'b0111,
+		C_ACTIVE    = 'b0011,
+		C_READ      = 'b0101,
+		C_WRITE     = 'b0100,
+		C_PRECHARGE = 'b0010,
+		C_REFRESH   = 'b0001,
+		C_MODE      = 'b0000;
+
+	bit[15:0] halves[1 << MEM_BITS];
+
+	bit[31:0] words[1 << MEM_BITS-1];
+
+	initial if (FILE !== 'x) begin
+		$readmemh(FILE, words);
+
+		for (int pos = 0; pos < 1 << MEM_BITS-1; pos++)
+			{ halves[2*pos + 1], halves[2*pos] } = words[pos];
+
+	end
+
+	bit[ROW_BITS-1:0] rows[1 << BANK_BITS];
+	bit[(1 << BANK_BITS)-1:0] open = 0;
+
+	bit[2:0] cas = 0;
+	bit[3:0] burst = 0;
+	bit single_writes = 0;
+
+	// Read data in flight, indexed by clocks left until it shows up.
+	bit[15:0] pipe_data[8];
+	bit[7:0] pipe_valid = 0;
+
+	// Beats left in the current read burst, and where the next one is.
+	bit[3:0] beats = 0;
+	bit[MEM_BITS-1:0] next_half;
+	bit precharge_after;
+	bit[BANK_BITS-1:0] burst_bank;
+
+	wire[3:0] command = { sdram_cs_, sdram_ras_, sdram_cas_, sdram_we_ };
+
+	wire[MEM_BITS-1:0] half =
+		MEM_BITS'({ rows[sdram_ba], sdram_ba, sdram_a[COL_BITS-1:0] });
+
+	assign sdram_dq = pipe_valid[0] ? pipe_data[0] : 'z;
+
+	always @(posedge sdram_clock) if (sdram_cke) begin
+		pipe_valid <= pipe_valid >> 1;
+
+		for (int pos = 0; pos < 7; pos++)
+			pipe_data[pos] <= pipe_data[pos+1];
+
+		if (beats) begin
+			pipe_data[cas-1] <= halves[next_half];
+			pipe_valid[cas-1] <= 1;
+			next_half <= next_half+1;
+			beats <= beats-1;
+
+			if (beats == 1 && precharge_after)
+				open[burst_bank] <= 0;
+
+		end
+
+		case (command)
+
+		C_ACTIVE: begin
+			if (open[sdram_ba])
+				$error("SDRAM: bank %0d activated while open", sdram_ba);
+
+			rows[sdram_ba] <= sdram_a;
+			open[sdram_ba] <= 1;
+		end
+
+		C_READ: begin
+			if (!open[sdram_ba])
+				$error("SDRAM: read from closed bank %0d", sdram_ba);
+
+			// The first beat goes out right away.
+			pipe_data[cas-1] <= halves[half];
+			pipe_valid[cas-1] <= 1;
+			next_half <= half+1;
+			beats <= burst-1;
+			precharge_after <= sdram_a[10];
+			burst_bank <= sdram_ba;
+
+			if (burst == 1 && sdram_a[10])
+				open[sdram_ba] <= 0;
+
+		end
+
+		C_WRITE: begin
+			if (!open[sdram_ba])
+				$error("SDRAM: write to closed bank %0d", sdram_ba);
+
+			if (!single_writes)
+				$error("SDRAM: only single-location writes are modelled");
+
+			if (!sdram_dm[0])
+				halves[half][7:0] <= sdram_dq[7:0];
+
+			if (!sdram_dm[1])
+				halves[half][15:8] <= sdram_dq[15:8];
+
+			if (sdram_a[10])
+				open[sdram_ba] <= 0;
+
+		end
+
+		C_PRECHARGE:
+			if (sdram_a[10])
+				open <= 0;
+			else
+				open[sdram_ba] <= 0;
+
+		C_REFRESH:
+			if (open)
+				$error("SDRAM: refresh with open banks");
+
+		C_MODE: begin
+			cas <= sdram_a[6:4];
+			burst <= 1 << sdram_a[2:0];
+			single_writes <= sdram_a[9];
+		end
+
+		endcase
+
+	end
+
+endmodule
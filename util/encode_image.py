@@ -35,6 +35,57 @@ def rgb444(image, noise):
 
     return encoded
 
+def rgb444_words(image, noise):
+    blob = image.convert('RGB').tobytes()
+    blob = [downsample_4bpc(byte, noise) for byte in blob]
+    encoded = bytearray()
+    pixels = batched(blob, 3)
+
+    for r, g, b in pixels:
+        encoded.append(g << 4 | b)
+        encoded.append(r)
+        encoded.append(0)
+        encoded.append(0)
+
+    return encoded
+
+def quantize(image, bits):
+    return image.convert('RGB').quantize(1 << bits, dither=Image.FLOYDSTEINBERG)
+
+def indexed(image, bits):
+    blob = quantize(image, bits).tobytes()
+    lines = batched(blob, image.width)
+    encoded = bytearray()
+
+    # Indexed atlases are 256 texels wide, narrower images get padded.
+    blob = b''.join(line.ljust(256, b'\0') for line in lines)
+    words = batched(blob, 16 // bits)
+
+    # Each word holds 16 bits worth of indices, first texel at the bottom.
+    for indices in words:
+        word = 0
+
+        for pos, idx in enumerate(indices):
+            word |= idx << bits*pos
+
+        encoded += word.to_bytes(4, 'little')
+
+    return encoded
+
+def palette(image, bits):
+    blob = quantize(image, bits).getpalette()[:3 << bits]
+    blob = [downsample_6bpc(byte, None) for byte in blob]
+    encoded = bytearray()
+    swatches = batched(blob, 3)
+
+    for r, g, b in swatches:
+        encoded.append(0b11000000 & (g << 6) | b)
+        encoded.append(0b11110000 & (r << 4) | g >> 2)
+        encoded.append(r >> 4)
+        encoded.append(0)
+
+    return encoded
+
 def rgb666(image, noise):
     foo = image.point(lambda p: p & 0xF0)
     foo.save("test.png")
@@ -118,7 +169,10 @@ def sixel(image, noise):
 ENCODINGS = {
     'RGB': lambda image, _: image.convert('RGB').tobytes(),
     'RGB444': rgb444,
+    'RGB444W': rgb444_words,
     'RGB666': rgb666,
+    'I4': lambda image, _: indexed(image, 4),
+    'I8': lambda image, _: indexed(image, 8),
     'SOI444': soi444,
     'Sixel': sixel,
 }
@@ -127,6 +181,7 @@ parser = ArgumentParser()
 parser.add_argument('path')
 parser.add_argument('-e', '--encoding', default='RGB', choices=ENCODINGS)
 parser.add_argument('-n', '--noise')
+parser.add_argument('-p', '--palette')
 
 args = parser.parse_args()
 image = Image.open(args.path)
@@ -139,3 +194,10 @@ if args.noise:
 
 encoded = ENCODINGS[args.encoding](image, noise)
 stdout.buffer.write(encoded)
+
+# Indexed encodings also need their palette, as RGB666 words.
+if args.palette and args.encoding in ('I4', 'I8'):
+    bits = int(args.encoding[1:])
+
+    with open(args.palette, 'wb') as file:
+        file.write(palette(image, bits))
@@ -1,3 +1,62 @@
 #!/bin/python3
 
 from argparse import ArgumentParser
+
+def index(field, count):
+    # OBJ indices start at 1, negative ones count from the end.
+    idx = int(field)
+    return idx - 1 if idx > 0 else count + idx
+
+def triangles(path):
+    positions, coords = [], []
+
+    with open(path) as obj:
+        for line in obj:
+            fields = line.split()
+
+            if not fields:
+                continue
+
+            if fields[0] == 'v':
+                positions.append(fields[1:4])
+            elif fields[0] == 'vt':
+                coords.append([float(field) for field in fields[1:3]])
+            elif fields[0] == 'f':
+                corners = []
+
+                for vertex in fields[1:]:
+                    v, vt, *_ = vertex.split('/') + ['']
+                    xyz = positions[index(v, len(positions))]
+                    uv = coords[index(vt, len(coords))] if vt else [0.0, 0.0]
+                    corners.append((xyz, uv))
+
+                # Polygons become fans around their first corner.
+                for pos in range(1, len(corners) - 1):
+                    yield corners[0], corners[pos], corners[pos + 1]
+
+def vertex(xyz, uv, size):
+    # Texture coordinates in texels, with rows going down like the atlas.
+    u = uv[0] * size
+    v = (1 - uv[1]) * size
+
+    x, y, z = (f'FIX({coord})' for coord in xyz)
+    return f'{{ {{ {x}, {y}, {z} }}, {{ FIX({u:.3f}), FIX({v:.3f}) }} }}'
+
+parser = ArgumentParser(
+    prog='encode_obj',
+    description='turn an OBJ mesh into Triangle initializers for the firmware')
+
+parser.add_argument('path')
+parser.add_argument('-s', '--size', type=int, default=128)
+args = parser.parse_args()
+
+# Only the initializers, so the includer picks the name and the section.
+print(f'// Generated from {args.path} by util/encode_obj.py.')
+
+for tri in triangles(args.path):
+    print('{')
+
+    for xyz, uv in tri:
+        print(f'\t{vertex(xyz, uv, args.size)},')
+
+    print('},')
@@ -0,0 +1,71 @@
+#!/bin/python3
+
+from argparse import ArgumentParser
+from bisect import bisect_right
+from collections import Counter
+from re import fullmatch
+from subprocess import check_output
+from sys import exit
+
+def symbols(elf, nm):
+    addrs, names = [], []
+
+    for line in check_output([nm, '-n', elf], text=True).splitlines():
+        fields = line.split()
+
+        if len(fields) == 3 and fields[1] in 'tTwW':
+            addrs.append(int(fields[0], 16))
+            names.append(fields[2])
+
+    return addrs, names
+
+def samples(path):
+    with open(path) as log:
+        lines = [line.strip() for line in log]
+
+    # Only the last dump counts, from its header to its trailer. Prompts and
+    # echoes around it may look like addresses too.
+    headers = [pos for pos, line in enumerate(lines) if fullmatch(r'profile \d+', line)]
+
+    if not headers:
+        exit(f'{path}: no "profile N" header')
+
+    start = headers[-1] + 1
+    count = int(lines[start - 1].split()[1])
+    ends = [pos for pos in range(start, len(lines)) if fullmatch(r'dropped \d+', lines[pos])]
+
+    if not ends:
+        exit(f'{path}: no "dropped N" trailer after the header')
+
+    pcs = []
+
+    for line in lines[start:ends[0]]:
+        if not fullmatch(r'[0-9a-fA-F]+', line):
+            exit(f'{path}: not a sample: {line!r}')
+
+        pcs.append(int(line, 16))
+
+    if len(pcs) != count:
+        exit(f'{path}: {len(pcs)} samples, the header says {count}')
+
+    return pcs
+
+def symbolize(pc, addrs, names):
+    pos = bisect_right(addrs, pc) - 1
+    return names[pos] if pos >= 0 else f'0x{pc:08x}'
+
+parser = ArgumentParser(
+    prog='profile',
+    description='map the output of prof/dump to firmware symbols')
+
+parser.add_argument('log')
+parser.add_argument('-e', '--elf', default='build/firmware.elf')
+parser.add_argument('-n', '--nm', default='riscv64-unknown-elf-nm')
+args = parser.parse_args()
+
+addrs, names = symbols(args.elf, args.nm)
+hits = Counter(symbolize(pc, addrs, names) for pc in samples(args.log))
+total = sum(hits.values()) or 1
+
+for name, count in hits.most_common():
+    print(f'{100 * count / total:6.2f}% {count:8d}  {name}')